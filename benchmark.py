@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Runs ThreadPoolBenchmark and compares it against a stored baseline.
+
+Usage:
+    python3 benchmark.py --exe build/ThreadPoolBenchmark --save base.json
+    python3 benchmark.py --exe build/ThreadPoolBenchmark --baseline base.json
+
+A benchmark whose median wall time grew by more than --threshold percent
+over the baseline is reported as a regression, and the exit code is 1.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+
+def run_benchmark(exe, extra_args):
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, "results.json")
+        subprocess.run([exe, "--json", path] + extra_args, check=True)
+        with open(path) as file:
+            return json.load(file)
+
+
+def medians(results):
+    return {
+        entry["run_name"]: entry
+        for entry in results["benchmarks"]
+        if entry.get("aggregate_name") == "median"
+    }
+
+
+def compare(baseline, current, threshold):
+    base = medians(baseline)
+    regressions = []
+
+    print(f"{'Benchmark':32}{'Baseline':>12}{'Current':>12}{'Change':>10}")
+    print("-" * 66)
+    for name, entry in medians(current).items():
+        if name not in base:
+            print(f"{name:32}{'-':>12}{entry['real_time']:>12.3f}{'new':>10}")
+            continue
+
+        before = base[name]["real_time"]
+        after = entry["real_time"]
+        change = (after - before) / before * 100.0 if before > 0 else 0.0
+        flag = ""
+        if change > threshold:
+            flag = "  REGRESSION"
+            regressions.append(name)
+        print(f"{name:32}{before:>12.3f}{after:>12.3f}{change:>+9.1f}%{flag}")
+
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Run the benchmark suite and compare with a baseline")
+    parser.add_argument("--exe",
+                        help="path to the ThreadPoolBenchmark executable")
+    parser.add_argument("--results",
+                        help="compare this JSON file instead of running")
+    parser.add_argument("--baseline", help="baseline JSON to compare with")
+    parser.add_argument("--save", help="write the results here as baseline")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="allowed slowdown in percent (default: 10)")
+    args, extra_args = parser.parse_known_args()
+    if not args.exe and not args.results:
+        parser.error("either --exe or --results is required")
+
+    if args.results:
+        with open(args.results) as file:
+            current = json.load(file)
+    else:
+        current = run_benchmark(args.exe, extra_args)
+
+    if args.save:
+        with open(args.save, "w") as file:
+            json.dump(current, file, indent=2)
+        print(f"Baseline saved to {args.save}")
+
+    if args.baseline:
+        with open(args.baseline) as file:
+            baseline = json.load(file)
+        regressions = compare(baseline, current, args.threshold)
+        if regressions:
+            print(f"\n{len(regressions)} regression(s) over "
+                  f"{args.threshold:.0f}%: {', '.join(regressions)}")
+            return 1
+        print("\nNo regressions")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
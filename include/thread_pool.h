@@ -1,85 +1,404 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <concepts>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
 #include <functional>
 #include <future>
+#include <iterator>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <ranges>
+#include <semaphore>
+#include <stop_token>
+#include <stdexcept>
+#include <system_error>
 #include <thread>
+#include <thread_pool/bounded_queue.h>
+#include <thread_pool/cache_line.h>
+#include <thread_pool/cancellation.h>
+#include <thread_pool/coroutine.h>
+#include <thread_pool/cpu_relax.h>
+#include <thread_pool/future.h>
+#include <thread_pool/parallel_loop.h>
+#include <thread_pool/per_worker.h>
+#include <thread_pool/priority_lanes.h>
+#include <thread_pool/slab_allocator.h>
+#include <thread_pool/stats.h>
+#include <thread_pool/strand.h>
+#include <thread_pool/task_graph.h>
+#include <thread_pool/task_group.h>
+#include <thread_pool/task_function.h>
+#include <thread_pool/timer_wheel.h>
+#include <thread_pool/topology.h>
+#include <thread_pool/trace.h>
+#include <thread_pool/work_stealing_deque.h>
+#include <thread_pool/worker_arena.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// What a submission does when a bounded queue is full.
+enum class BackpressurePolicy {
+    // Sleep until a worker frees a slot.
+    Block,
+    // Yield in a loop until a slot frees up.
+    Spin,
+    // Throw QueueFullError. submit_bulk and submit_batch do not throw, the
+    // tasks that did not fit are dropped and their futures report
+    // std::future_errc::broken_promise.
+    Reject,
+};
+
+class QueueFullError : public std::runtime_error {
+  public:
+    QueueFullError() : std::runtime_error("ThreadPool queue is full") {}
+};
+
+// What a worker does when it runs out of work.
+enum class IdlePolicy {
+    // Park on the condition variable right away.
+    Block,
+    // Poll for spin_count rounds, then yield for yield_count rounds, then
+    // park. Saves the wakeup when work arrives shortly after.
+    SpinThenPark,
+    // Never park, yield once every spin_count rounds. Only for pools that
+    // have a core per worker.
+    Spin,
+};
+
+// What happens to a task from submit_deadline_task that is only picked up
+// after its deadline. Either way it is counted in missed_deadlines().
+enum class LateTaskPolicy {
+    // Run it anyway.
+    Flag,
+    // Skip it, its future reports DeadlineMissedError.
+    Drop,
+};
+
+class DeadlineMissedError : public std::runtime_error {
+  public:
+    DeadlineMissedError()
+        : std::runtime_error("ThreadPool task missed its deadline") {}
+};
+
+// Where workers run. Pinned workers stay on one CPU for their lifetime.
+enum class AffinityPolicy {
+    // Leave placement to the OS scheduler.
+    None,
+    // Fill the CPUs of one NUMA node before moving on to the next.
+    Compact,
+    // Deal workers out round-robin across NUMA nodes.
+    Scatter,
+};
+
+struct ThreadPoolOptions {
+    // When non-zero, a pool without priority scheduling uses a lock-free
+    // ring buffer of (at least) this many slots as its shared queue instead
+    // of the unbounded WorkQueue.
+    std::size_t queue_capacity = 0;
+    BackpressurePolicy backpressure = BackpressurePolicy::Block;
+    IdlePolicy idle_policy = IdlePolicy::Block;
+    std::size_t spin_count = 4096;
+    std::size_t yield_count = 16;
+    // Bounds of an elastic pool, 0 means the num_threads passed to the
+    // constructor. While every worker is busy, a submission starts another
+    // worker if the shared queue holds more tasks than there are workers,
+    // or if it holds any and some worker has been stuck in one task for
+    // blocked_after. Workers above min_threads exit after idle_timeout
+    // without work.
+    std::size_t min_threads = 0;
+    std::size_t max_threads = 0;
+    std::chrono::milliseconds idle_timeout{1000};
+    std::chrono::milliseconds blocked_after{10};
+    AffinityPolicy affinity = AffinityPolicy::None;
+    // Pins worker i to cpus[i % cpus.size()], overriding affinity.
+    std::vector<unsigned> cpus = {};
+    // Gives every NUMA node its own shared queue. Tasks go to the queue of
+    // the node they are submitted from, and workers serve their own node's
+    // queue before the others. Priorities only order tasks within a node.
+    // Has no effect on a bounded queue.
+    bool numa_local_queues = false;
+    // When non-zero, tasks without a priority or deadline are submitted
+    // into this many lock-free staging buffers, each thread always using
+    // the same one, instead of taking the shared queue's lock. Workers move
+    // staged tasks into the shared queue in batches, so producers on many
+    // threads no longer serialize on that lock. A full buffer falls back to
+    // the locked path. Has no effect on a bounded queue, which is lock-free
+    // already.
+    std::size_t submission_shards = 0;
+    // When non-zero, a queued priority task counts as one level higher for
+    // every priority_aging it has waited, so a steady stream of high
+    // priority work cannot starve low priorities forever. Each pop then
+    // costs one step per non-empty priority instead of O(1).
+    std::chrono::milliseconds priority_aging{0};
+    LateTaskPolicy late_tasks = LateTaskPolicy::Flag;
+    // Makes the destructor resume a paused pool and wait until every task
+    // has run. Otherwise tasks still queued are discarded and their futures
+    // report TaskCancelledError.
+    bool drain_on_destroy = false;
+    // Most threads the blocking lane grows to, see submit_blocking_task.
+    std::size_t max_blocking_threads = 256;
+    // Granularity of submit_after, submit_at and submit_every. A timer
+    // fires up to this much late, never early.
+    std::chrono::microseconds timer_resolution{1000};
+};
+
+namespace thread_pool_detail {
+    // Choices fixed at compile time on top of ThreadPool's three flags,
+    // usually put together by PolicyThreadPool. These defaults leave queue
+    // and idle policy to ThreadPoolOptions.
+    struct DefaultConfig {
+        // Non-zero forces the bounded lock-free queue with this capacity.
+        static constexpr std::size_t queue_capacity = 0;
+        // Replaces ThreadPoolOptions::idle_policy when fixed.
+        static constexpr bool fixed_idle_policy = false;
+        static constexpr IdlePolicy idle_policy = IdlePolicy::Block;
+        // Without it, exceptions escaping detached tasks are dropped
+        // without looking for an exception handler.
+        static constexpr bool forward_exceptions = true;
+    };
+}  // namespace thread_pool_detail
 
-template <bool EnablePriorityScheduling = true>
+// With EnableWorkStealing every worker owns a Chase-Lev deque. Tasks
+// submitted from inside a worker are pushed onto that worker's deque and idle
+// workers steal from random victims; tasks submitted from other threads, and
+// all priority tasks, go through the shared WorkQueue.
+// EnableStats turns on the counters and histograms behind get_stats. Left
+// off, none of them is compiled in. Config is a DefaultConfig-like struct,
+// see PolicyThreadPool.
+template <bool EnablePriorityScheduling = true,
+          bool EnableWorkStealing = false,
+          bool EnableStats = false,
+          typename Config = thread_pool_detail::DefaultConfig>
 class ThreadPool {
+    static_assert(Config::queue_capacity == 0 || !EnablePriorityScheduling,
+                  "A bounded queue requires priority scheduling to be "
+                  "disabled");
+
   public:
     using Priority = std::int8_t;
+    using Deadline = std::chrono::steady_clock::time_point;
+    using ExceptionHandler = std::function<void(std::exception_ptr)>;
 
   private:
-    class WorkQueue {
+    static constexpr Deadline no_deadline = Deadline::max();
+    static constexpr std::int64_t no_timer =
+        std::numeric_limits<std::int64_t>::max();
+    static constexpr std::size_t no_timer_keeper =
+        std::numeric_limits<std::size_t>::max();
+
+    // Tasks with a deadline are kept in a min-heap and always run before
+    // the others, earliest deadline first. The rest run by priority, or in
+    // submission order without priority scheduling. Aligned so the queues
+    // of different NUMA nodes share no cache line.
+    class alignas(thread_pool_detail::cache_line_size) WorkQueue {
         struct WorkItem {
-            std::function<void()> task;
+            thread_pool_detail::TaskFunction task;
             Priority priority;
-
-            bool operator<(const WorkItem& other) const {
-                return priority < other.priority;
-            }
+            Deadline deadline = no_deadline;
         };
 
+        static bool later_deadline(const WorkItem& a, const WorkItem& b) {
+            return a.deadline > b.deadline;
+        }
+
       public:
+        // Aging interval in steady_clock ticks, 0 disables aging. Set before
+        // any task is pushed.
+        void set_aging(std::int64_t interval) {
+            aging_interval = interval;
+        }
+
         void push(WorkItem work_item) {
-            work_queue.push(std::move(work_item));
+            if (work_item.deadline != no_deadline) {
+                deadline_queue.push_back(std::move(work_item));
+                std::push_heap(deadline_queue.begin(),
+                               deadline_queue.end(),
+                               later_deadline);
+            } else if constexpr (EnablePriorityScheduling) {
+                work_queue.push(work_item.priority,
+                                std::move(work_item.task),
+                                aging_interval != 0 ? now() : 0);
+            } else {
+                work_queue.push(std::move(work_item));
+            }
+            count.store(size(), std::memory_order_relaxed);
         }
 
         WorkItem pop() {
-            WorkItem work_item;
+            WorkItem work_item{};
 
-            if constexpr (EnablePriorityScheduling) {
-                work_item = work_queue.top();
+            if (!deadline_queue.empty()) {
+                std::pop_heap(deadline_queue.begin(),
+                              deadline_queue.end(),
+                              later_deadline);
+                work_item = std::move(deadline_queue.back());
+                deadline_queue.pop_back();
+            } else if constexpr (EnablePriorityScheduling) {
+                work_item.task = aging_interval != 0
+                                     ? work_queue.pop_aged(now(),
+                                                           aging_interval)
+                                     : work_queue.pop();
             } else {
-                work_item = work_queue.front();
+                work_item = std::move(work_queue.front());
+                work_queue.pop();
             }
 
-            work_queue.pop();
+            count.store(size(), std::memory_order_relaxed);
             return work_item;
         }
 
         bool empty() const {
-            return work_queue.empty();
+            return work_queue.empty() && deadline_queue.empty();
+        }
+
+        // May be read without holding the lock, the value can be stale.
+        std::size_t approximate_size() const {
+            return count.load(std::memory_order_relaxed);
         }
 
       private:
+        static std::int64_t now() {
+            return std::chrono::steady_clock::now().time_since_epoch().count();
+        }
+
+        std::size_t size() const {
+            return work_queue.size() + deadline_queue.size();
+        }
+
+        // Equal priorities run in submission order.
         std::conditional_t<EnablePriorityScheduling,
-                           std::priority_queue<WorkItem>,
+                           thread_pool_detail::PriorityLanes<
+                               thread_pool_detail::TaskFunction>,
                            std::queue<WorkItem>>
             work_queue;
+        std::vector<WorkItem> deadline_queue;
+        std::int64_t aging_interval = 0;
+        std::atomic<std::size_t> count = 0;
+    };
+
+    using LocalTask = thread_pool_detail::TaskFunction;
+
+    struct Worker {
+        Worker(ThreadPool* pool, std::size_t index)
+            : pool{pool}, rng{0x9e3779b97f4a7c15ULL * (index + 1)} {}
+
+        ThreadPool* pool;
+        thread_pool_detail::WorkStealingDeque<LocalTask> deque;
+        std::uint64_t rng;
+    };
+
+    using BoundedQueue =
+        thread_pool_detail::BoundedQueue<thread_pool_detail::TaskFunction>;
+    using BlockingLane = ThreadPool<false, false, EnableStats>;
+
+    // One submit_every series, shared by its successive runs.
+    struct PeriodicTask {
+        thread_pool_detail::TaskFunction run;
+        std::chrono::steady_clock::duration period;
+        Deadline due;
+        std::stop_token stop;
+        // Stopped by cancel_all.
+        std::stop_token cancel;
+    };
+
+    struct alignas(thread_pool_detail::cache_line_size) WorkerSlot {
+        std::binary_semaphore wake{0};
+        // steady_clock ticks at which the current task started, 0 while
+        // idle. Only kept up to date by elastic pools.
+        std::atomic<std::int64_t> busy_since = 0;
+        // Guarded by queue_mutex.
+        bool active = false;
+        // Fixed at construction.
+        int cpu = -1;
+        std::size_t home_queue = 0;
+        // See this_worker_resource. Only used by the slot's worker.
+        thread_pool_detail::WorkerArena arena;
     };
 
+    static inline thread_local ThreadPool* current_pool = nullptr;
+    static inline thread_local Worker* current_worker = nullptr;
+    static inline thread_local std::size_t current_slot = 0;
+
   public:
-    explicit ThreadPool(std::size_t num_threads)
-        : num_threads{num_threads}, tasks_running{num_threads} {
-        threads.reserve(num_threads);
+    explicit ThreadPool(std::size_t num_threads = std::max(
+                            1u, std::thread::hardware_concurrency()),
+                        ThreadPoolOptions options = {})
+        : min_threads{options.min_threads != 0 ? options.min_threads
+                                               : num_threads},
+          max_threads{options.max_threads != 0 ? options.max_threads
+                                               : num_threads},
+          elastic{min_threads < max_threads},
+          options{options},
+          target_threads{num_threads} {
+        if (min_threads > num_threads || max_threads < num_threads) {
+            throw std::invalid_argument(
+                "num_threads must lie between min_threads and max_threads");
+        }
 
-        for (std::size_t i = 0; i < num_threads; ++i) {
-            threads.emplace_back([this]() mutable {
-                while (true) {
-                    {
-                        std::unique_lock<std::mutex> lock(queue_mutex);
-                        --tasks_running;
+        this->options.timer_resolution = std::max(
+            options.timer_resolution, std::chrono::microseconds(1));
+
+        if (Config::queue_capacity != 0) {
+            bounded_queue =
+                std::make_unique<BoundedQueue>(Config::queue_capacity);
+        } else if (options.queue_capacity != 0) {
+            if (EnablePriorityScheduling) {
+                throw std::invalid_argument(
+                    "A bounded queue requires priority scheduling to be "
+                    "disabled");
+            }
+            bounded_queue = std::make_unique<BoundedQueue>(
+                options.queue_capacity);
+        } else {
+            staging_buffers.reserve(options.submission_shards);
+            for (std::size_t i = 0; i < options.submission_shards; ++i) {
+                staging_buffers.push_back(
+                    std::make_unique<BoundedQueue>(staging_capacity));
+            }
+        }
 
-                        cv.wait(lock, [this]() {
-                            return stop || !work_queue.empty();
-                        });
+        // Everything a worker needs is allocated up front for max_threads
+        // workers, so the pool can grow without moving anything that other
+        // workers read.
+        if constexpr (EnableWorkStealing) {
+            workers.reserve(max_threads);
+            for (std::size_t i = 0; i < max_threads; ++i) {
+                workers.emplace_back(std::make_unique<Worker>(this, i));
+            }
+        }
 
-                        if (stop) {
-                            return;
-                        }
+        queue_count = options.numa_local_queues
+                          ? thread_pool_detail::Topology::get().nodes().size()
+                          : 1;
+        work_queues = std::make_unique<WorkQueue[]>(queue_count);
+        for (std::size_t queue = 0; queue < queue_count; ++queue) {
+            work_queues[queue].set_aging(
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    options.priority_aging)
+                    .count());
+        }
 
-                        auto work_item = work_queue.pop();
+        slots = std::make_unique<WorkerSlot[]>(max_threads);
+        if constexpr (EnableStats) {
+            // One more for threads outside the pool.
+            counters = std::make_unique<thread_pool_detail::WorkerCounters[]>(
+                max_threads + 1);
+        }
+        place_workers();
+        parked_workers.reserve(max_threads);
+        threads.resize(max_threads);
 
-                        ++tasks_running;
-                        lock.unlock();
-                        work_item.task();
-                    }
-                }
-            });
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        for (std::size_t i = 0; i < num_threads; ++i) {
+            start_worker(i);
         }
     }
 
@@ -101,27 +420,661 @@ class ThreadPool {
             priority, std::forward<F>(f), std::forward<Args>(args)...);
     }
 
+    // Same as submit_task(f, args...), with name shown for the task in
+    // traces.
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    std::future<std::invoke_result_t<F, Args...>> submit_task(TaskName name,
+                                                              F&& f,
+                                                              Args&&... args) {
+        thread_pool_detail::ScopedTaskName scope(name);
+        return submit_task(std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    // Skips f if a stop was requested on token before it starts, its
+    // future then reports TaskCancelledError. When f accepts a
+    // std::stop_token as first parameter it is passed token, so it can
+    // also stop cooperatively once running. cancel_all requests a stop on
+    // get_stop_token().
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...> ||
+                 std::invocable<F, std::stop_token, Args...>
+    auto submit_task(std::stop_token token, F&& f, Args&&... args) {
+        return submit_task_helper(
+            0,
+            [token = std::move(token),
+             f = std::forward<F>(f),
+             ... args = std::forward<Args>(args)]() mutable {
+                if (token.stop_requested()) {
+                    throw TaskCancelledError();
+                }
+                if constexpr (std::invocable<F, std::stop_token, Args...>) {
+                    return std::invoke(f, token, std::move(args)...);
+                } else {
+                    return std::invoke(f, std::move(args)...);
+                }
+            });
+    }
+
+    // Like submit_task, but returns a Future that supports then, when_all
+    // and when_any.
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    Future<std::invoke_result_t<F, Args...>> submit_future(F&& f,
+                                                           Args&&... args) {
+        using ResultType = std::invoke_result_t<F, Args...>;
+
+        auto state = std::allocate_shared<
+            thread_pool_detail::FutureState<ResultType>>(
+            thread_pool_detail::PoolAllocator<
+                thread_pool_detail::FutureState<ResultType>>{});
+        Future<ResultType> result(state);
+
+        enqueue(0,
+                [state = std::move(state),
+                 f = std::forward<F>(f),
+                 ... args = std::forward<Args>(args)]() mutable {
+                    if (thread_pool_detail::cancelling) {
+                        state->set_result({std::nullopt,
+                                           std::make_exception_ptr(
+                                               TaskCancelledError())});
+                        return;
+                    }
+                    state->fulfill([&]() -> ResultType {
+                        return std::invoke(f, args...);
+                    });
+                });
+        return result;
+    }
+
+    // co_await pool.schedule() suspends the calling coroutine and resumes
+    // it on one of the pool's workers.
+    thread_pool_detail::ScheduleAwaiter<ThreadPool> schedule() {
+        return thread_pool_detail::ScheduleAwaiter<ThreadPool>(*this);
+    }
+
+    // Starts task on a worker. The returned Future completes with the
+    // task's result once the coroutine has finished.
+    template <typename T>
+    Future<T> submit_coroutine(Task<T> task) {
+        auto state = std::make_shared<thread_pool_detail::FutureState<T>>();
+        Future<T> result(state);
+        thread_pool_detail::drive_task(
+            *this, std::move(task), std::move(state));
+        return result;
+    }
+
+    // Queues f ahead of all tasks without a deadline, earliest deadline
+    // first. A task picked up after its deadline is handled according to
+    // options.late_tasks. With a bounded queue, deadline tasks share the FIFO
+    // ring and are only checked for lateness.
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    std::future<std::invoke_result_t<F, Args...>> submit_deadline_task(
+        Deadline deadline, F&& f, Args&&... args) {
+        auto [work_item, result] = package_task(
+            [this,
+             deadline,
+             f = std::forward<F>(f),
+             ... args = std::forward<Args>(args)]() mutable {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    missed_deadline_count.fetch_add(
+                        1, std::memory_order_relaxed);
+                    if (options.late_tasks == LateTaskPolicy::Drop) {
+                        throw DeadlineMissedError();
+                    }
+                }
+                return std::invoke(f, args...);
+            });
+
+        enqueue(0, std::move(work_item), deadline);
+        return std::move(result);
+    }
+
+    // Runs f once delay has passed. Pending timers live in a hierarchical
+    // timer wheel, which an idle worker waits on, so they cost no thread
+    // and little memory each. They do not count as unfinished tasks until
+    // they are due, so wait_idle does not wait for them. cancel_all and the
+    // destructor cancel them, and their futures report TaskCancelledError.
+    template <typename Rep, typename Period, typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    std::future<std::invoke_result_t<F, Args...>> submit_after(
+        std::chrono::duration<Rep, Period> delay, F&& f, Args&&... args) {
+        return submit_at(
+            std::chrono::steady_clock::now() +
+                std::chrono::ceil<std::chrono::steady_clock::duration>(delay),
+            std::forward<F>(f),
+            std::forward<Args>(args)...);
+    }
+
+    // Runs f once time has come, see submit_after.
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    std::future<std::invoke_result_t<F, Args...>> submit_at(
+        std::chrono::steady_clock::time_point time, F&& f, Args&&... args) {
+        auto [work_item, result] =
+            package_task(std::forward<F>(f), std::forward<Args>(args)...);
+
+        add_timer(time, std::move(work_item));
+        return std::move(result);
+    }
+
+    // Runs f every period, the first time one period from now, until stop
+    // is requested on the returned source or cancel_all runs. A run is due
+    // one period after the previous one was, or right after it finished if
+    // it ran late, so runs never overlap and missed ones are not made up.
+    // An exception escaping f goes to the exception handler.
+    template <typename Rep, typename Period, typename F, typename... Args>
+        requires std::invocable<F&, Args&...>
+    std::stop_source submit_every(std::chrono::duration<Rep, Period> period,
+                                  F&& f,
+                                  Args&&... args) {
+        std::stop_source source;
+        auto series = std::make_shared<PeriodicTask>(PeriodicTask{
+            [f = std::forward<F>(f),
+             ... args = std::forward<Args>(args)]() mutable {
+                std::invoke(f, args...);
+            },
+            std::chrono::ceil<std::chrono::steady_clock::duration>(period),
+            {},
+            source.get_token(),
+            get_stop_token()});
+        series->due = std::chrono::steady_clock::now() + series->period;
+
+        schedule_periodic(std::move(series));
+        return source;
+    }
+
+    // Runs f on the blocking lane, for tasks that mostly sleep or wait for
+    // I/O. The lane has threads of its own, started whenever a blocking
+    // task finds all of them busy, up to options.max_blocking_threads, and
+    // retired after idle_timeout. Blocking tasks therefore never hold one
+    // of the pool's own workers, the compute lane, which is best sized to
+    // hardware_concurrency, the default. wait_idle, cancel_all, pause and
+    // the destructor cover both lanes.
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    std::future<std::invoke_result_t<F, Args...>> submit_blocking_task(
+        F&& f, Args&&... args) {
+        auto [work_item, result] =
+            package_task(std::forward<F>(f), std::forward<Args>(args)...);
+
+        enqueue_blocking(std::move(work_item));
+        return std::move(result);
+    }
+
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    void detach_blocking_task(F&& f, Args&&... args) {
+        enqueue_blocking(package_detached_task(std::forward<F>(f),
+                                               std::forward<Args>(args)...));
+    }
+
+    // Submits one task per element of range, each calling f(element).
+    // Elements that are lvalues are passed by reference, so the range must
+    // outlive the returned futures; anything else is copied into the task.
+    template <std::ranges::input_range Range, typename F>
+        requires std::invocable<F&, std::ranges::range_reference_t<Range>>
+    auto submit_bulk(Range&& range, F&& f) {
+        using Reference = std::ranges::range_reference_t<Range>;
+        using ResultType = std::invoke_result_t<F&, Reference>;
+
+        std::vector<std::future<ResultType>> futures;
+        std::vector<thread_pool_detail::TaskFunction> tasks;
+        if constexpr (std::ranges::sized_range<Range>) {
+            futures.reserve(std::ranges::size(range));
+            tasks.reserve(std::ranges::size(range));
+        }
+
+        // One copy of f shared by the whole batch.
+        auto shared_f = std::make_shared<std::decay_t<F>>(std::forward<F>(f));
+
+        for (auto&& element : range) {
+            if constexpr (std::is_lvalue_reference_v<Reference>) {
+                auto [task, future] = package_task(
+                    [shared_f, element = std::addressof(element)]() {
+                        return std::invoke(*shared_f, *element);
+                    });
+                tasks.push_back(std::move(task));
+                futures.push_back(std::move(future));
+            } else {
+                auto [task, future] = package_task(
+                    [shared_f](std::ranges::range_value_t<Range> value) {
+                        return std::invoke(*shared_f, std::move(value));
+                    },
+                    std::ranges::range_value_t<Range>(element));
+                tasks.push_back(std::move(task));
+                futures.push_back(std::move(future));
+            }
+        }
+
+        enqueue_batch(std::move(tasks), options.backpressure);
+        return futures;
+    }
+
+    // Submits every callable in [first, last) under a single lock.
+    template <std::input_iterator Iterator,
+              std::sentinel_for<Iterator> Sentinel>
+        requires std::invocable<std::iter_value_t<Iterator>&>
+    auto submit_batch(Iterator first, Sentinel last) {
+        using ResultType = std::invoke_result_t<std::iter_value_t<Iterator>&>;
+
+        std::vector<std::future<ResultType>> futures;
+        std::vector<thread_pool_detail::TaskFunction> tasks;
+        if constexpr (std::sized_sentinel_for<Sentinel, Iterator>) {
+            futures.reserve(static_cast<std::size_t>(last - first));
+            tasks.reserve(static_cast<std::size_t>(last - first));
+        }
+
+        for (; first != last; ++first) {
+            auto [task, future] =
+                package_task(std::iter_value_t<Iterator>(*first));
+            tasks.push_back(std::move(task));
+            futures.push_back(std::move(future));
+        }
+
+        enqueue_batch(std::move(tasks), options.backpressure);
+        return futures;
+    }
+
+    // Runs body(i) for every i in [begin, end). The calling thread takes part
+    // in the loop and returns once every iteration has finished, rethrowing
+    // the first exception thrown by body.
+    template <std::integral Index, typename Body>
+        requires std::invocable<Body&, Index>
+    void parallel_for(Index begin,
+                      Index end,
+                      Body&& body,
+                      ChunkPolicy policy = ChunkPolicy::Auto,
+                      std::size_t grain_size = 0) {
+        auto chunk_fn = [&body, begin](std::size_t first, std::size_t last) {
+            for (std::size_t i = first; i < last; ++i) {
+                std::invoke(body, static_cast<Index>(begin + i));
+            }
+        };
+
+        run_parallel_loop(loop_size(begin, end), chunk_fn, policy, grain_size);
+    }
+
+    // Folds reduce over map(i) for every i in [begin, end), starting from
+    // init. reduce must be associative; partial results are combined in
+    // index order, so it need not be commutative.
+    template <std::integral Index, typename T, typename Map, typename Reduce>
+        requires std::invocable<Map&, Index> &&
+                 std::convertible_to<std::invoke_result_t<Map&, Index>, T> &&
+                 std::invocable<Reduce&, T, T>
+    T parallel_reduce(Index begin,
+                      Index end,
+                      T init,
+                      Map&& map,
+                      Reduce&& reduce,
+                      ChunkPolicy policy = ChunkPolicy::Auto,
+                      std::size_t grain_size = 0) {
+        std::mutex partials_mutex;
+        std::vector<std::pair<std::size_t, T>> partials;
+
+        auto chunk_fn = [&, begin](std::size_t first, std::size_t last) {
+            T partial = std::invoke(map, static_cast<Index>(begin + first));
+            for (std::size_t i = first + 1; i < last; ++i) {
+                partial = std::invoke(
+                    reduce,
+                    std::move(partial),
+                    T(std::invoke(map, static_cast<Index>(begin + i))));
+            }
+
+            std::lock_guard<std::mutex> lock(partials_mutex);
+            partials.emplace_back(first, std::move(partial));
+        };
+
+        run_parallel_loop(loop_size(begin, end), chunk_fn, policy, grain_size);
+
+        std::sort(partials.begin(),
+                  partials.end(),
+                  [](const auto& a, const auto& b) {
+                      return a.first < b.first;
+                  });
+        for (auto& partial : partials) {
+            init = std::invoke(
+                reduce, std::move(init), std::move(partial.second));
+        }
+        return init;
+    }
+
+    // Fire-and-forget submission: no promise or future is created. An
+    // exception escaping f is passed to the pool's exception handler.
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    void detach_task(F&& f, Args&&... args) {
+        detach_task_helper(0, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    void detach_task(TaskName name, F&& f, Args&&... args) {
+        thread_pool_detail::ScopedTaskName scope(name);
+        detach_task_helper(0, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    void detach_priority_task(Priority priority, F&& f, Args&&... args) {
+        static_assert(EnablePriorityScheduling,
+                      "Priority scheduling should be enabled");
+        detach_task_helper(
+            priority, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    // Like detach_task, but f also runs when cancel_all discards it, with
+    // cancellation flagged, so continuations built on top of the pool can
+    // complete their own results as cancelled.
+    template <typename F>
+        requires std::invocable<F>
+    void post(F&& f) {
+        enqueue(0,
+                [this, f = std::forward<F>(f)]() mutable {
+                    try {
+                        std::invoke(f);
+                    } catch (...) {
+                        handle_exception(std::current_exception());
+                    }
+                });
+    }
+
+    // Discards every task still queued or waiting for its timer without
+    // running it: their futures report TaskCancelledError, detached tasks
+    // are dropped and periodic tasks end. Tasks already running are not
+    // interrupted, but a stop is requested on the token handed out by
+    // get_stop_token so cooperative ones can finish early. Returns the
+    // number of tasks discarded.
+    std::size_t cancel_all() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            cancel_source.request_stop();
+            cancel_source = std::stop_source();
+        }
+
+        std::size_t discarded = 0;
+        if (BlockingLane* lane =
+                blocking_lane_ptr.load(std::memory_order_acquire)) {
+            discarded += lane->cancel_all();
+        }
+        return discarded + discard_queued_tasks();
+    }
+
+    // Holds back queued and newly submitted tasks until resume. Tasks
+    // already running finish normally.
+    void pause() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        paused.store(true, std::memory_order_relaxed);
+        if (blocking_pool) {
+            blocking_pool->pause();
+        }
+    }
+
+    // Releases everything queued while paused at once.
+    void resume() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        paused.store(false, std::memory_order_relaxed);
+        wake_parked_workers(parked_workers.size());
+        if (blocking_pool) {
+            blocking_pool->resume();
+        }
+    }
+
+    // Blocks until every submitted task has finished, including tasks they
+    // submitted in turn. Sleeps on the task counter instead of polling.
+    // Never returns while the pool is paused with work queued, and must not
+    // be called from one of the pool's own tasks.
+    void wait_idle() const {
+        std::size_t pending = unfinished_tasks.load(std::memory_order_acquire);
+        while (pending != 0) {
+            unfinished_tasks.wait(pending, std::memory_order_acquire);
+            pending = unfinished_tasks.load(std::memory_order_acquire);
+        }
+    }
+
+    void wait_for_all() const {
+        wait_idle();
+    }
+
+    // Tasks submitted but not finished yet, queued or running.
+    std::size_t get_tasks_total() const {
+        return unfinished_tasks.load(std::memory_order_relaxed);
+    }
+
+    // Like future.get(), except that until the result is there the calling
+    // thread runs other queued tasks of this pool instead of blocking. A
+    // task can wait for tasks it submitted without idling its worker, which
+    // on a saturated pool would deadlock, so recursive divide and conquer
+    // works on any number of threads.
+    template <typename T>
+    T wait(std::future<T>& future) {
+        help_until([&future](std::chrono::microseconds timeout) {
+            return future.wait_for(timeout) == std::future_status::ready;
+        });
+        return future.get();
+    }
+
+    template <typename T>
+    T wait(std::future<T>&& future) {
+        return wait(future);
+    }
+
+    template <typename T>
+    T wait(Future<T>& future) {
+        help_until([&future](std::chrono::microseconds timeout) {
+            return future.wait_for(timeout) == std::future_status::ready;
+        });
+        return future.get();
+    }
+
+    template <typename T>
+    T wait(Future<T>&& future) {
+        return wait(future);
+    }
+
+    // Like wait(future), until done() returns true. Without tasks to run
+    // the caller yields between polls, so done should be cheap, e.g. an
+    // atomic load; see TaskGroup.
+    template <typename Done>
+        requires std::predicate<Done&>
+    void wait_until(Done&& done) {
+        help_until([&done](std::chrono::microseconds timeout) {
+            if (done()) {
+                return true;
+            }
+            if (timeout.count() != 0) {
+                std::this_thread::yield();
+            }
+            return static_cast<bool>(done());
+        });
+    }
+
+    // Scratch memory for the task running on this thread: the worker's own
+    // arena, which is reset after every task it runs, or the default
+    // resource outside of any pool's workers. Allocating bumps a pointer
+    // and deallocating does nothing, so short-lived pmr containers inside
+    // a task never contend on the global allocator. Nothing allocated from
+    // it may outlive the task, including its result. Tasks run inside
+    // wait or a strand batch share the arena with the task around them.
+    static std::pmr::memory_resource* this_worker_resource() {
+        if (thread_pool_detail::current_arena != nullptr) {
+            return thread_pool_detail::current_arena;
+        }
+        return std::pmr::get_default_resource();
+    }
+
+    // Token that is stopped by the next cancel_all.
+    std::stop_token get_stop_token() const {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        return cancel_source.get_token();
+    }
+
+    // Called on the worker thread for every exception thrown by a detached
+    // task. Without a handler such exceptions are dropped. The handler must
+    // not throw.
+    void set_exception_handler(ExceptionHandler handler) {
+        static_assert(Config::forward_exceptions,
+                      "Exceptions are discarded by this pool's policy");
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        exception_handler = std::move(handler);
+    }
+
+    // Reports every task submitted from now on, and every park and wake of
+    // a worker, to hooks, e.g. a TraceRecorder. nullptr turns tracing off
+    // again. hooks must outlive the pool.
+    void set_trace_hooks(TraceHooks* hooks) {
+        trace_hooks.store(hooks, std::memory_order_release);
+    }
+
     std::size_t thread_count() const {
-        return num_threads;
+        return live_threads.load(std::memory_order_relaxed);
     }
 
-    std::size_t get_tasks_running() const {
+    // Worker indices lie below this: num_threads, or max_threads for an
+    // elastic pool. A worker started in place of a retired one reuses its
+    // index.
+    std::size_t max_thread_count() const {
+        return max_threads;
+    }
+
+    static constexpr std::size_t no_worker =
+        std::numeric_limits<std::size_t>::max();
+
+    // Index of the calling thread among this pool's workers, or no_worker
+    // on any other thread, a worker of another pool included. Tasks can
+    // use it to keep per-worker state, see PerWorker.
+    std::size_t current_worker_index() const {
+        return current_pool == this ? current_slot : no_worker;
+    }
+
+    bool is_worker_thread() const {
+        return current_pool == this;
+    }
+
+    // Sets the number of workers to n, which must lie between 1 and
+    // max_threads (num_threads for a fixed-size pool). New workers start
+    // right away, surplus ones exit as soon as they run out of work. An
+    // elastic pool keeps adjusting within its bounds afterwards.
+    void resize(std::size_t n) {
+        if (n == 0 || n > max_threads) {
+            throw std::invalid_argument(
+                "ThreadPool::resize: thread count out of range");
+        }
+
         std::lock_guard<std::mutex> lock(queue_mutex);
-        return tasks_running;
+        target_threads = n;
+
+        const std::size_t live = live_threads.load(std::memory_order_relaxed);
+        if (live > n) {
+            // Parked surplus workers only notice once they wake up.
+            wake_parked_workers(live - n);
+        }
+
+        for (std::size_t index = 0; index < max_threads; ++index) {
+            if (live_threads.load(std::memory_order_relaxed) >= n) {
+                break;
+            }
+            if (!slots[index].active) {
+                start_worker(index);
+            }
+        }
+    }
+
+    // Deadline tasks that started, or were dropped, after their deadline.
+    std::size_t missed_deadlines() const {
+        return missed_deadline_count.load(std::memory_order_relaxed);
+    }
+
+    // Reads the counters without taking any lock, so it can be polled from
+    // a monitoring thread without slowing the workers down.
+    ThreadPoolStats get_stats() const
+        requires EnableStats
+    {
+        ThreadPoolStats stats;
+        stats.workers.resize(max_threads);
+        for (std::size_t index = 0; index <= max_threads; ++index) {
+            const thread_pool_detail::WorkerCounters& worker = counters[index];
+            const std::uint64_t executed =
+                worker.tasks_executed.load(std::memory_order_relaxed);
+            const std::uint64_t lock_waits =
+                worker.lock_waits.load(std::memory_order_relaxed);
+            const std::chrono::nanoseconds lock_wait_time(
+                worker.lock_wait_ns.load(std::memory_order_relaxed));
+            if (index == max_threads) {
+                stats.tasks_executed_by_callers = executed;
+                stats.caller_lock_waits = lock_waits;
+                stats.caller_lock_wait_time = lock_wait_time;
+            } else {
+                stats.workers[index] = {
+                    executed,
+                    worker.steals.load(std::memory_order_relaxed),
+                    worker.parks.load(std::memory_order_relaxed),
+                    std::chrono::nanoseconds(
+                        worker.idle_ns.load(std::memory_order_relaxed)),
+                    std::chrono::nanoseconds(
+                        worker.busy_ns.load(std::memory_order_relaxed)),
+                    lock_waits,
+                    lock_wait_time};
+                stats.compute.busy_time += stats.workers[index].busy_time;
+                stats.compute.idle_time += stats.workers[index].idle_time;
+            }
+            worker.queue_wait.add_to(stats.queue_wait);
+            worker.run_time.add_to(stats.run_time);
+        }
+
+        stats.queued_tasks += queued_task_count();
+        if constexpr (EnableWorkStealing) {
+            for (const auto& worker : workers) {
+                stats.queued_tasks += worker->deque.size();
+            }
+        }
+        stats.unfinished_tasks = get_tasks_total();
+
+        stats.compute.threads = live_threads.load(std::memory_order_relaxed);
+        const std::size_t idle =
+            idle_workers.load(std::memory_order_relaxed) +
+            spinning_workers.load(std::memory_order_relaxed);
+        stats.compute.busy_threads =
+            stats.compute.threads > idle ? stats.compute.threads - idle : 0;
+        if (const BlockingLane* lane =
+                blocking_lane_ptr.load(std::memory_order_acquire)) {
+            stats.blocking = lane->get_stats().compute;
+        }
+        return stats;
+    }
+
+    // Workers not parked right now. Lock-free, so it may be stale.
+    std::size_t get_tasks_running() const {
+        return tasks_running.load(std::memory_order_relaxed);
     }
 
     ~ThreadPool() {
+        if (options.drain_on_destroy) {
+            resume();
+            wait_idle();
+        }
+
         {
             std::lock_guard<std::mutex> lock(queue_mutex);
             stop = true;
+            wake_parked_workers(parked_workers.size());
         }
-        cv.notify_all();
+        space_cv.notify_all();
 
         for (auto& thread : threads) {
             if (thread.joinable()) {
                 thread.join();
             }
         }
+
+        // Blocking tasks still running may submit to this pool, whose
+        // queue is discarded next.
+        blocking_lane_ptr.store(nullptr, std::memory_order_relaxed);
+        blocking_pool.reset();
+
+        // Whatever is still queued never runs.
+        discard_queued_tasks();
     }
 
   private:
@@ -129,42 +1082,1555 @@ class ThreadPool {
         requires std::invocable<F, Args...>
     std::future<std::invoke_result_t<F, Args...>> submit_task_helper(
         Priority priority, F&& f, Args&&... args) {
+        auto [work_item, result] =
+            package_task(std::forward<F>(f), std::forward<Args>(args)...);
+
+        enqueue(priority, std::move(work_item));
+        return std::move(result);
+    }
+
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    std::pair<thread_pool_detail::TaskFunction,
+              std::future<std::invoke_result_t<F, Args...>>>
+    package_task(F&& f, Args&&... args) {
         using ResultType = std::invoke_result_t<F, Args...>;
 
-        auto promise = std::make_shared<std::promise<ResultType>>();
-        std::future<ResultType> result = promise->get_future();
+        // The shared state comes from the slab allocator and the wrapper
+        // below fits in TaskFunction's inline storage for typical captures,
+        // so a submission normally does not allocate at all.
+        std::promise<ResultType> promise(
+            std::allocator_arg,
+            thread_pool_detail::PoolAllocator<ResultType>{});
+        std::future<ResultType> result = promise.get_future();
 
-        std::function<void()> work_item =
+        thread_pool_detail::TaskFunction work_item =
             [f = std::forward<F>(f),
              ... args = std::forward<Args>(args),
              promise = std::move(promise)]() mutable {
+                if (thread_pool_detail::cancelling) {
+                    promise.set_exception(
+                        std::make_exception_ptr(TaskCancelledError()));
+                    return;
+                }
                 try {
                     if constexpr (std::is_void_v<ResultType>) {
                         std::invoke(f, args...);
-                        promise->set_value();
+                        promise.set_value();
                     } else {
-                        promise->set_value(std::invoke(f, args...));
+                        promise.set_value(std::invoke(f, args...));
                     }
                 } catch (...) {
-                    promise->set_exception(std::current_exception());
+                    promise.set_exception(std::current_exception());
                 }
             };
 
-        {
-            std::lock_guard<std::mutex> lock(queue_mutex);
-            work_queue.push({work_item, priority});
-        }
-
-        cv.notify_one();
-        return result;
+        return {std::move(work_item), std::move(result)};
     }
 
-  private:
-    std::size_t num_threads;
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    void detach_task_helper(Priority priority, F&& f, Args&&... args) {
+        enqueue(priority,
+                package_detached_task(std::forward<F>(f),
+                                      std::forward<Args>(args)...));
+    }
+
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    thread_pool_detail::TaskFunction package_detached_task(F&& f,
+                                                           Args&&... args) {
+        return [this,
+                f = std::forward<F>(f),
+                ... args = std::forward<Args>(args)]() mutable {
+            if (thread_pool_detail::cancelling) {
+                return;
+            }
+            try {
+                std::invoke(f, args...);
+            } catch (...) {
+                handle_exception(std::current_exception());
+            }
+        };
+    }
+
+    // Counted and traced here, timed by the lane itself.
+    void enqueue_blocking(thread_pool_detail::TaskFunction task) {
+        unfinished_tasks.fetch_add(1, std::memory_order_relaxed);
+        if (TraceHooks* hooks = trace_hooks.load(std::memory_order_acquire)) {
+            task = traced_task(*hooks, std::move(task));
+        }
+
+        blocking_lane().post([this, task = std::move(task)]() mutable {
+            task();
+            finish_tasks(1);
+        });
+    }
+
+    // Created on first use. Without min_threads and with blocked_after at
+    // zero, the lane starts a thread for any task that finds every thread
+    // busy, and retires all of them when idle.
+    BlockingLane& blocking_lane() {
+        std::call_once(blocking_lane_created, [this]() {
+            auto lane = std::make_unique<BlockingLane>(
+                0,
+                ThreadPoolOptions{
+                    .max_threads = options.max_blocking_threads,
+                    .idle_timeout = options.idle_timeout,
+                    .blocked_after = std::chrono::milliseconds(0)});
+
+            // Under the lock, so pause and resume see the lane either
+            // before or after it is paused to match.
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (paused.load(std::memory_order_relaxed)) {
+                lane->pause();
+            }
+            blocking_pool = std::move(lane);
+            blocking_lane_ptr.store(blocking_pool.get(),
+                                    std::memory_order_release);
+        });
+        return *blocking_pool;
+    }
+
+    void enqueue(Priority priority,
+                 thread_pool_detail::TaskFunction task,
+                 Deadline deadline = no_deadline) {
+        if (!try_enqueue(priority, task, options.backpressure, deadline)) {
+            throw QueueFullError();
+        }
+    }
+
+    // Only fails, leaving task unqueued, when a bounded queue is full and
+    // policy is Reject.
+    bool try_enqueue(Priority priority,
+                     thread_pool_detail::TaskFunction& task,
+                     BackpressurePolicy policy,
+                     Deadline deadline = no_deadline) {
+        unfinished_tasks.fetch_add(1, std::memory_order_relaxed);
+        if constexpr (EnableStats) {
+            task = timed_task(std::move(task));
+        }
+        if (TraceHooks* hooks = trace_hooks.load(std::memory_order_acquire)) {
+            task = traced_task(*hooks, std::move(task));
+        }
+
+        if constexpr (EnableWorkStealing) {
+            if (current_pool == this && priority == 0 &&
+                deadline == no_deadline) {
+                current_worker->deque.push(new_local_task(std::move(task)));
+                notify_idle_worker();
+                maybe_grow();
+                return true;
+            }
+        }
+
+        if (has_bounded_queue()) {
+            if (!push_bounded(task, policy)) {
+                finish_tasks(1);
+                return false;
+            }
+            notify_idle_worker();
+            maybe_grow();
+            return true;
+        }
+
+        if (!staging_buffers.empty() && priority == 0 &&
+            deadline == no_deadline && staging_buffer().try_push(task)) {
+            notify_idle_worker();
+            maybe_grow();
+            return true;
+        }
+
+        WorkerSlot* slot = nullptr;
+        {
+            const std::size_t queue = submit_queue();
+            std::unique_lock<std::mutex> lock = lock_queue();
+            // Whatever this thread staged before goes first, so its tasks
+            // keep their order when its buffer overflows.
+            if (!staging_buffers.empty()) {
+                drain_staging_buffer(staging_buffer(), work_queues[queue]);
+            }
+            work_queues[queue].push({std::move(task), priority, deadline});
+            slot = unpark_worker(queue);
+        }
+
+        // Released outside the lock, so the woken worker does not block on
+        // it right away.
+        if (slot != nullptr) {
+            slot->wake.release();
+        } else {
+            maybe_grow();
+        }
+        return true;
+    }
+
+    bool push_bounded(thread_pool_detail::TaskFunction& task,
+                      BackpressurePolicy policy) {
+        while (!bounded_queue->try_push(task)) {
+            if (policy == BackpressurePolicy::Reject) {
+                return false;
+            }
+
+            // A worker waiting for room could wait on itself, so it runs
+            // the task instead. So does cancel_all, which would otherwise
+            // wait for the queue it is emptying.
+            if (current_pool == this || thread_pool_detail::cancelling) {
+                task();
+                task = {};
+                finish_tasks(1);
+                return true;
+            }
+
+            if (policy == BackpressurePolicy::Spin) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            blocked_producers.fetch_add(1, std::memory_order_seq_cst);
+            space_cv.wait(lock,
+                          [this]() { return stop || !bounded_queue->full(); });
+            blocked_producers.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        return true;
+    }
+
+    // Pairs with the blocked_producers increment in push_bounded, the same
+    // way notify_idle_worker pairs with sleeping workers.
+    void notify_blocked_producer() {
+        if (blocked_producers.load(std::memory_order_seq_cst) > 0) {
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+            }
+            space_cv.notify_one();
+        }
+    }
+
+    // Pops any queued task: from the shared queues, then from the workers'
+    // deques.
+    bool take_queued_task(thread_pool_detail::TaskFunction& task) {
+        if (has_bounded_queue()) {
+            if (bounded_queue->try_pop(task)) {
+                notify_blocked_producer();
+                return true;
+            }
+        } else {
+            std::unique_lock<std::mutex> lock = lock_queue();
+            drain_staging_buffers(0);
+            for (std::size_t queue = 0; queue < queue_count; ++queue) {
+                if (!work_queues[queue].empty()) {
+                    task = work_queues[queue].pop().task;
+                    return true;
+                }
+            }
+        }
+
+        if constexpr (EnableWorkStealing) {
+            for (auto& worker : workers) {
+                if (LocalTask* local = worker->deque.steal()) {
+                    task = std::move(*local);
+                    delete_local_task(local);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Runs queued tasks, the calling worker's own ones first, until ready
+    // reports the awaited result. With nothing to run it blocks in ready
+    // for a short while and looks again, since the result may depend on
+    // tasks submitted meanwhile. Runs nothing while the pool is paused.
+    template <typename Ready>
+    void help_until(Ready&& ready) {
+        constexpr std::chrono::microseconds idle_wait{50};
+
+        thread_pool_detail::TaskFunction task;
+        while (!ready(std::chrono::microseconds(0))) {
+            if (paused.load(std::memory_order_relaxed) ||
+                !take_pending_task(task)) {
+                ready(idle_wait);
+                continue;
+            }
+            task();
+            task = {};
+            finish_tasks(1);
+        }
+    }
+
+    bool take_pending_task(thread_pool_detail::TaskFunction& task) {
+        if constexpr (EnableWorkStealing) {
+            if (current_pool == this) {
+                if (LocalTask* local = current_worker->deque.pop()) {
+                    task = std::move(*local);
+                    delete_local_task(local);
+                    return true;
+                }
+            }
+        }
+        return take_queued_task(task);
+    }
+
+    // Locks queue_mutex on the paths every task takes. With EnableStats a
+    // lock found taken is counted, and the wait for it timed, on the
+    // calling thread's counters; the uncontended path costs one try_lock.
+    std::unique_lock<std::mutex> lock_queue() {
+        if constexpr (EnableStats) {
+            std::unique_lock<std::mutex> lock(queue_mutex, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                const auto started = std::chrono::steady_clock::now();
+                lock.lock();
+                thread_pool_detail::WorkerCounters& counter =
+                    counters[current_pool == this ? current_slot
+                                                  : max_threads];
+                counter.lock_waits.fetch_add(1, std::memory_order_relaxed);
+                counter.lock_wait_ns.fetch_add(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - started)
+                        .count(),
+                    std::memory_order_relaxed);
+            }
+            return lock;
+        } else {
+            return std::unique_lock<std::mutex>(queue_mutex);
+        }
+    }
+
+    // Known at compile time unless the queue is chosen by options.
+    bool has_bounded_queue() const {
+        if constexpr (Config::queue_capacity != 0) {
+            return true;
+        } else if constexpr (EnablePriorityScheduling) {
+            return false;
+        } else {
+            return bounded_queue != nullptr;
+        }
+    }
+
+    IdlePolicy idle_policy() const {
+        if constexpr (Config::fixed_idle_policy) {
+            return Config::idle_policy;
+        } else {
+            return options.idle_policy;
+        }
+    }
+
+    // Caller holds queue_mutex.
+    bool shared_queue_has_work() const {
+        if (has_bounded_queue()) {
+            return !bounded_queue->empty();
+        }
+
+        for (std::size_t queue = 0; queue < queue_count; ++queue) {
+            if (!work_queues[queue].empty()) {
+                return true;
+            }
+        }
+        for (const auto& buffer : staging_buffers) {
+            if (!buffer->empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The calling thread's staging buffer. Threads are dealt out
+    // round-robin in the order they first submit.
+    BoundedQueue& staging_buffer() {
+        static std::atomic<std::size_t> next_producer = 0;
+        static thread_local const std::size_t producer =
+            next_producer.fetch_add(1, std::memory_order_relaxed);
+        return *staging_buffers[producer % staging_buffers.size()];
+    }
+
+    // Caller holds queue_mutex. Moves every staged task into the home
+    // queue of worker index.
+    void drain_staging_buffers(std::size_t index) {
+        WorkQueue& queue = work_queues[slots[index].home_queue];
+        for (const auto& buffer : staging_buffers) {
+            drain_staging_buffer(*buffer, queue);
+        }
+    }
+
+    // Caller holds queue_mutex.
+    static void drain_staging_buffer(BoundedQueue& buffer, WorkQueue& queue) {
+        thread_pool_detail::TaskFunction task;
+        while (buffer.try_pop(task)) {
+            queue.push({std::move(task), 0});
+        }
+    }
+
+    // Caller holds queue_mutex. The first non-empty queue, starting from
+    // the home queue of worker index.
+    WorkQueue* find_work_queue(std::size_t index) {
+        const std::size_t home = slots[index].home_queue;
+        for (std::size_t i = 0; i < queue_count; ++i) {
+            WorkQueue& queue = work_queues[(home + i) % queue_count];
+            if (!queue.empty()) {
+                return &queue;
+            }
+        }
+        return nullptr;
+    }
+
+    // Queue for a task submitted by the calling thread: a worker's home
+    // queue, otherwise the queue of the node the thread is running on.
+    std::size_t submit_queue() const {
+        if (queue_count == 1) {
+            return 0;
+        }
+
+        if (current_pool == this) {
+            return slots[current_slot].home_queue;
+        }
+        return thread_pool_detail::Topology::get().current_node() %
+               queue_count;
+    }
+
+    std::size_t queued_task_count() const {
+        if (has_bounded_queue()) {
+            return bounded_queue->size();
+        }
+
+        std::size_t count = 0;
+        for (std::size_t queue = 0; queue < queue_count; ++queue) {
+            count += work_queues[queue].approximate_size();
+        }
+        for (const auto& buffer : staging_buffers) {
+            count += buffer->size();
+        }
+        return count;
+    }
+
+    void add_timer(Deadline time, thread_pool_detail::TaskFunction task) {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        const std::uint64_t previous = timers.next_event();
+        timers.add(timer_tick(time), std::move(task));
+        if (timers.next_event() < previous) {
+            update_next_timer();
+            wake_timer_keeper();
+        }
+    }
+
+    // Each run queues the next one once it has finished.
+    void schedule_periodic(std::shared_ptr<PeriodicTask> series) {
+        const Deadline due = series->due;
+        add_timer(due, [this, series = std::move(series)]() mutable {
+            auto stopped = [&]() {
+                return thread_pool_detail::cancelling ||
+                       series->stop.stop_requested() ||
+                       series->cancel.stop_requested();
+            };
+            if (stopped()) {
+                return;
+            }
+
+            try {
+                series->run();
+            } catch (...) {
+                handle_exception(std::current_exception());
+            }
+
+            if (!stopped()) {
+                series->due = std::max(series->due + series->period,
+                                       std::chrono::steady_clock::now());
+                schedule_periodic(std::move(series));
+            }
+        });
+    }
+
+    // Queues every task whose timer is due.
+    void fire_timers() {
+        std::vector<thread_pool_detail::TaskFunction> due;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            timers.advance(current_timer_tick(),
+                           [&](thread_pool_detail::TaskFunction task) {
+                               due.push_back(std::move(task));
+                           });
+            update_next_timer();
+        }
+
+        if (!due.empty()) {
+            enqueue_batch(std::move(due), BackpressurePolicy::Block);
+        }
+    }
+
+    // Lock-free and possibly stale, like has_work_hint. Busy workers check
+    // it between tasks, so timers fire even when nobody is parked.
+    bool timer_due() const {
+        const std::int64_t next = next_timer.load(std::memory_order_relaxed);
+        return next != no_timer &&
+               next <= std::chrono::steady_clock::now()
+                           .time_since_epoch()
+                           .count();
+    }
+
+    // Caller holds queue_mutex.
+    void update_next_timer() {
+        const std::uint64_t next = timers.next_event();
+        next_timer.store(next == decltype(timers)::never
+                             ? no_timer
+                             : timer_time(next).time_since_epoch().count(),
+                         std::memory_order_relaxed);
+    }
+
+    // Caller holds queue_mutex. Makes the timer keeper, or some parked
+    // worker if there is none, wait again for the new first timer.
+    void wake_timer_keeper() {
+        if (timer_keeper == no_timer_keeper) {
+            wake_parked_workers(1);
+            return;
+        }
+
+        auto parked = std::find(parked_workers.begin(),
+                                parked_workers.end(),
+                                timer_keeper);
+        if (parked != parked_workers.end()) {
+            parked_workers.erase(parked);
+            idle_workers.store(parked_workers.size(),
+                               std::memory_order_relaxed);
+            slots[timer_keeper].wake.release();
+        }
+    }
+
+    std::chrono::steady_clock::duration timer_resolution() const {
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            options.timer_resolution);
+    }
+
+    // The first tick starting at or after time.
+    std::uint64_t timer_tick(Deadline time) const {
+        const auto elapsed = time - timer_origin;
+        if (elapsed <= std::chrono::steady_clock::duration::zero()) {
+            return 0;
+        }
+        return static_cast<std::uint64_t>(
+            (elapsed + timer_resolution() -
+             std::chrono::steady_clock::duration(1)) /
+            timer_resolution());
+    }
+
+    // The last tick that has started.
+    std::uint64_t current_timer_tick() const {
+        return static_cast<std::uint64_t>(
+            (std::chrono::steady_clock::now() - timer_origin) /
+            timer_resolution());
+    }
+
+    Deadline timer_time(std::uint64_t tick) const {
+        return timer_origin +
+               timer_resolution() *
+                   static_cast<std::chrono::steady_clock::rep>(tick);
+    }
+
+    // Gives every slot its CPU, if pinned, and its home queue.
+    void place_workers() {
+        const auto& topology = thread_pool_detail::Topology::get();
+        const auto& nodes = topology.nodes();
+
+        std::vector<unsigned> order = options.cpus;
+        if (order.empty() && options.affinity == AffinityPolicy::Compact) {
+            for (const auto& node : nodes) {
+                order.insert(order.end(), node.begin(), node.end());
+            }
+        } else if (order.empty() &&
+                   options.affinity == AffinityPolicy::Scatter) {
+            for (std::size_t depth = 0; order.size() < topology.cpu_count();
+                 ++depth) {
+                for (const auto& node : nodes) {
+                    if (depth < node.size()) {
+                        order.push_back(node[depth]);
+                    }
+                }
+            }
+        }
+
+        for (std::size_t index = 0; index < max_threads; ++index) {
+            WorkerSlot& slot = slots[index];
+            std::size_t node = index % nodes.size();
+            if (!order.empty()) {
+                const unsigned cpu = order[index % order.size()];
+                slot.cpu = static_cast<int>(cpu);
+                node = topology.node_of(cpu);
+            }
+            slot.home_queue = node % queue_count;
+        }
+    }
+
+    template <typename Index>
+    static std::size_t loop_size(Index begin, Index end) {
+        return end > begin ? static_cast<std::size_t>(end - begin) : 0;
+    }
+
+    template <typename ChunkFn>
+    void run_parallel_loop(std::size_t size,
+                           ChunkFn& chunk_fn,
+                           ChunkPolicy policy,
+                           std::size_t grain_size) {
+        using Loop = thread_pool_detail::ParallelLoop<ChunkFn>;
+
+        // The calling thread is one of the participants.
+        auto loop = std::make_shared<Loop>(
+            size, chunk_fn, policy, thread_count() + 1, grain_size);
+
+        std::vector<thread_pool_detail::TaskFunction> helpers;
+        for (std::size_t i = 0; i < loop->helpers_wanted(); ++i) {
+            helpers.emplace_back(
+                [this, loop]() { join_parallel_loop(loop); });
+        }
+        if (!helpers.empty()) {
+            // Helpers are optional, the loop makes progress without them.
+            enqueue_batch(std::move(helpers), BackpressurePolicy::Reject);
+        }
+
+        join_parallel_loop(loop);
+        loop->wait();
+    }
+
+    template <typename Loop>
+    void join_parallel_loop(const std::shared_ptr<Loop>& loop) {
+        loop->participate(
+            [this]() {
+                return idle_workers.load(std::memory_order_relaxed) > 0 ||
+                       spinning_workers.load(std::memory_order_relaxed) > 0;
+            },
+            [this, &loop]() {
+                // A discarded helper is harmless, the caller of the loop
+                // takes part until every chunk is done.
+                thread_pool_detail::TaskFunction helper = [this, loop]() {
+                    if (!thread_pool_detail::cancelling) {
+                        join_parallel_loop(loop);
+                    }
+                };
+                try_enqueue(0, helper, BackpressurePolicy::Reject);
+            });
+    }
+
+    // Pushes every task in one critical section and wakes no more workers
+    // than there are tasks. Tasks rejected by a full bounded queue are
+    // dropped.
+    void enqueue_batch(std::vector<thread_pool_detail::TaskFunction> tasks,
+                       BackpressurePolicy policy) {
+        unfinished_tasks.fetch_add(tasks.size(), std::memory_order_relaxed);
+        if constexpr (EnableStats) {
+            for (auto& task : tasks) {
+                task = timed_task(std::move(task));
+            }
+        }
+        if (TraceHooks* hooks = trace_hooks.load(std::memory_order_acquire)) {
+            for (auto& task : tasks) {
+                task = traced_task(*hooks, std::move(task));
+            }
+        }
+
+        const bool lock_free_push =
+            (EnableWorkStealing && current_pool == this) || has_bounded_queue();
+        if (lock_free_push) {
+            std::size_t pushed = 0;
+            for (auto& task : tasks) {
+                if constexpr (EnableWorkStealing) {
+                    if (current_pool == this) {
+                        current_worker->deque.push(
+                            new_local_task(std::move(task)));
+                        ++pushed;
+                        continue;
+                    }
+                }
+
+                if (!push_bounded(task, policy)) {
+                    break;
+                }
+                ++pushed;
+            }
+            if (pushed < tasks.size()) {
+                finish_tasks(tasks.size() - pushed);
+            }
+
+            if (pushed > 0 &&
+                idle_workers.load(std::memory_order_seq_cst) > 0) {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                wake_parked_workers(pushed);
+            }
+            maybe_grow();
+            return;
+        }
+
+        {
+            const std::size_t queue = submit_queue();
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            for (auto& task : tasks) {
+                work_queues[queue].push({std::move(task), 0});
+            }
+            wake_parked_workers(tasks.size(), queue);
+        }
+        maybe_grow();
+    }
+
+    // Caller holds queue_mutex. Takes the most recently parked worker off
+    // the parked list, its caches are the most likely to still be warm.
+    // With NUMA-local queues a worker whose home is queue goes first.
+    WorkerSlot* unpark_worker(std::size_t queue = 0) {
+        if (parked_workers.empty()) {
+            return nullptr;
+        }
+
+        // The timer keeper is the last choice, it would have to hand its
+        // wait over.
+        auto parked = std::prev(parked_workers.end());
+        if (*parked == timer_keeper && parked_workers.size() > 1) {
+            --parked;
+        }
+        if (queue_count > 1) {
+            auto local = std::find_if(
+                parked_workers.rbegin(),
+                parked_workers.rend(),
+                [&](std::size_t index) {
+                    return slots[index].home_queue == queue;
+                });
+            if (local != parked_workers.rend()) {
+                parked = std::prev(local.base());
+            }
+        }
+
+        const std::size_t index = *parked;
+        parked_workers.erase(parked);
+        idle_workers.store(parked_workers.size(), std::memory_order_relaxed);
+        return &slots[index];
+    }
+
+    // Caller holds queue_mutex.
+    void wake_parked_workers(std::size_t count, std::size_t queue = 0) {
+        for (std::size_t i = 0; i < count; ++i) {
+            WorkerSlot* slot = unpark_worker(queue);
+            if (slot == nullptr) {
+                return;
+            }
+            slot->wake.release();
+        }
+    }
+
+    // Caller holds queue_mutex through lock. Parks worker index until
+    // another thread unparks it, unless has_work() turns true once the
+    // worker is visible as parked. Pushers that do not take the lock check
+    // idle_workers after their seq_cst push, so one of the two sides sees
+    // the other. Returns with the lock held again; the caller has to
+    // re-check for work, a woken worker may have lost the task to another.
+    // Returns false when the worker retired after idle_timeout.
+    template <typename HasWork>
+    bool park(std::unique_lock<std::mutex>& lock,
+              std::size_t index,
+              HasWork&& has_work) {
+        parked_workers.push_back(index);
+        idle_workers.store(parked_workers.size(), std::memory_order_seq_cst);
+
+        if (has_work()) {
+            // Nobody else touched the list while we held the lock.
+            parked_workers.pop_back();
+            idle_workers.store(parked_workers.size(),
+                               std::memory_order_relaxed);
+            return true;
+        }
+
+        // The first worker to park while timers are pending waits for the
+        // next of them too. It never retires meanwhile.
+        const bool keeps_timers =
+            timer_keeper == no_timer_keeper && !timers.empty();
+        Deadline timer_wait{};
+        if (keeps_timers) {
+            timer_keeper = index;
+            timer_wait = timer_time(timers.next_event());
+        }
+        const bool may_retire =
+            !keeps_timers && elastic &&
+            live_threads.load(std::memory_order_relaxed) > min_threads;
+
+        tasks_running.fetch_sub(1, std::memory_order_relaxed);
+        lock.unlock();
+        std::chrono::steady_clock::time_point parked_at;
+        if constexpr (EnableStats) {
+            parked_at = std::chrono::steady_clock::now();
+        }
+        TraceHooks* hooks = trace_hooks.load(std::memory_order_acquire);
+        if (hooks != nullptr) {
+            hooks->on_park(index);
+        }
+        bool woken = true;
+        if (keeps_timers) {
+            woken = slots[index].wake.try_acquire_until(timer_wait);
+        } else if (may_retire) {
+            woken = slots[index].wake.try_acquire_for(options.idle_timeout);
+        } else {
+            slots[index].wake.acquire();
+        }
+        if (hooks != nullptr) {
+            hooks->on_wake(index);
+        }
+        if constexpr (EnableStats) {
+            thread_pool_detail::WorkerCounters& worker = counters[index];
+            worker.parks.fetch_add(1, std::memory_order_relaxed);
+            worker.idle_ns.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - parked_at)
+                    .count(),
+                std::memory_order_relaxed);
+        }
+        lock.lock();
+        tasks_running.fetch_add(1, std::memory_order_relaxed);
+        if (keeps_timers) {
+            timer_keeper = no_timer_keeper;
+        }
+
+        if (woken) {
+            return true;
+        }
+
+        auto parked = std::find(parked_workers.begin(),
+                                parked_workers.end(),
+                                index);
+        if (parked == parked_workers.end()) {
+            // Unparked just as the wait timed out, take the wakeup.
+            slots[index].wake.acquire();
+            return true;
+        }
+
+        parked_workers.erase(parked);
+        idle_workers.store(parked_workers.size(), std::memory_order_relaxed);
+
+        if (keeps_timers || stop ||
+            live_threads.load(std::memory_order_relaxed) <= min_threads) {
+            return true;
+        }
+
+        --target_threads;
+        retire_worker(index);
+        return false;
+    }
+
+    // Caller holds queue_mutex. The slot's previous thread, if any, has
+    // retired and no longer touches the pool.
+    void start_worker(std::size_t index) {
+        if (threads[index].joinable()) {
+            threads[index].join();
+        }
+
+        threads[index] = std::thread([this, index]() {
+            if (slots[index].cpu >= 0) {
+                thread_pool_detail::pin_current_thread(
+                    static_cast<unsigned>(slots[index].cpu));
+            }
+
+            if constexpr (EnableWorkStealing) {
+                work_stealing_loop(*workers[index], index);
+            } else {
+                worker_loop(index);
+            }
+        });
+
+        slots[index].active = true;
+        live_threads.fetch_add(1, std::memory_order_relaxed);
+        tasks_running.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Caller holds queue_mutex. The worker returns from its loop right after.
+    void retire_worker(std::size_t index) {
+        slots[index].arena.release();
+        slots[index].active = false;
+        live_threads.fetch_sub(1, std::memory_order_relaxed);
+        tasks_running.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Caller holds queue_mutex. Surplus workers left over from resize()
+    // exit instead of waiting for work.
+    bool retire_if_surplus(std::size_t index) {
+        if (live_threads.load(std::memory_order_relaxed) <= target_threads) {
+            return false;
+        }
+
+        retire_worker(index);
+        return true;
+    }
+
+    // Starts one more worker in an elastic pool whose workers are all busy,
+    // when the shared queue is longer than the number of workers or holds
+    // anything while a worker looks blocked.
+    void maybe_grow() {
+        if (!elastic || idle_workers.load(std::memory_order_relaxed) > 0 ||
+            spinning_workers.load(std::memory_order_relaxed) > 0) {
+            return;
+        }
+
+        const std::size_t live = live_threads.load(std::memory_order_relaxed);
+        if (live >= max_threads) {
+            return;
+        }
+
+        const std::size_t backlog = queued_task_count();
+        if (backlog == 0 || (backlog <= live && !has_blocked_worker())) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (stop || !parked_workers.empty() ||
+            live_threads.load(std::memory_order_relaxed) >= max_threads) {
+            return;
+        }
+
+        for (std::size_t index = 0; index < max_threads; ++index) {
+            if (!slots[index].active) {
+                try {
+                    start_worker(index);
+                    ++target_threads;
+                } catch (const std::system_error&) {
+                    // Out of threads, carry on with the workers we have.
+                }
+                return;
+            }
+        }
+    }
+
+    bool has_blocked_worker() const {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        const auto threshold =
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                options.blocked_after);
+
+        for (std::size_t index = 0; index < max_threads; ++index) {
+            const std::int64_t since =
+                slots[index].busy_since.load(std::memory_order_relaxed);
+            if (since != 0 && now.count() - since >= threshold.count()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Runs task on worker index, recording its start for has_blocked_worker,
+    // then resets the worker's arena.
+    template <typename Task>
+    void run_task(std::size_t index, Task& task) {
+        if (!elastic) {
+            task();
+            slots[index].arena.reset();
+            finish_tasks(1);
+            return;
+        }
+
+        std::atomic<std::int64_t>& busy_since = slots[index].busy_since;
+        busy_since.store(
+            std::chrono::steady_clock::now().time_since_epoch().count(),
+            std::memory_order_relaxed);
+        task();
+        busy_since.store(0, std::memory_order_relaxed);
+        slots[index].arena.reset();
+        finish_tasks(1);
+    }
+
+    // Records how long task waited in the queue and ran, on the counters of
+    // whichever thread runs it. Discarded tasks are not counted.
+    thread_pool_detail::TaskFunction timed_task(
+        thread_pool_detail::TaskFunction task) {
+        return [this,
+                task = std::move(task),
+                submitted = std::chrono::steady_clock::now()]() mutable {
+            if (thread_pool_detail::cancelling) {
+                task();
+                return;
+            }
+
+            const auto started = std::chrono::steady_clock::now();
+            task();
+            const auto finished = std::chrono::steady_clock::now();
+
+            thread_pool_detail::WorkerCounters& worker =
+                counters[current_pool == this ? current_slot : max_threads];
+            worker.queue_wait.record(started - submitted);
+            worker.run_time.record(finished - started);
+            worker.busy_ns.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    finished - started)
+                    .count(),
+                std::memory_order_relaxed);
+            worker.tasks_executed.fetch_add(1, std::memory_order_relaxed);
+        };
+    }
+
+    // Reports task to hooks when it is submitted, starts and finishes.
+    thread_pool_detail::TaskFunction traced_task(
+        TraceHooks& hooks, thread_pool_detail::TaskFunction task) {
+        const std::uint64_t id =
+            next_task_id.fetch_add(1, std::memory_order_relaxed);
+        const char* name = thread_pool_detail::submitting_task_name;
+        hooks.on_submit(id, name, trace_worker());
+
+        return [this, &hooks, id, name, task = std::move(task)]() mutable {
+            if (thread_pool_detail::cancelling) {
+                task();
+                return;
+            }
+
+            const std::size_t worker = trace_worker();
+            hooks.on_start(id, name, worker);
+            task();
+            hooks.on_finish(id, name, worker);
+        };
+    }
+
+    std::size_t trace_worker() const {
+        return current_pool == this ? current_slot : TraceHooks::external;
+    }
+
+    // acq_rel: wait_idle sees the effects of every finished task.
+    void finish_tasks(std::size_t count) {
+        if (unfinished_tasks.fetch_sub(count, std::memory_order_acq_rel) ==
+            count) {
+            unfinished_tasks.notify_all();
+        }
+    }
+
+    // Runs every queued task in cancelling mode, see cancel_all.
+    std::size_t discard_queued_tasks() {
+        const bool was_cancelling = thread_pool_detail::cancelling;
+        thread_pool_detail::cancelling = true;
+
+        // Timers are not counted as unfinished tasks yet.
+        std::vector<thread_pool_detail::TaskFunction> waiting;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            timers.clear([&](thread_pool_detail::TaskFunction task) {
+                waiting.push_back(std::move(task));
+            });
+            update_next_timer();
+        }
+        for (auto& timer : waiting) {
+            timer();
+        }
+
+        std::size_t discarded = waiting.size();
+        thread_pool_detail::TaskFunction task;
+        while (take_queued_task(task)) {
+            task();
+            task = {};
+            finish_tasks(1);
+            ++discarded;
+        }
+
+        thread_pool_detail::cancelling = was_cancelling;
+        return discarded;
+    }
+
+    void handle_exception(std::exception_ptr exception) {
+        if constexpr (!Config::forward_exceptions) {
+            return;
+        }
+
+        ExceptionHandler handler;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            handler = exception_handler;
+        }
+
+        if (handler) {
+            handler(std::move(exception));
+        }
+    }
+
+    void worker_loop(std::size_t index) {
+        current_pool = this;
+        current_slot = index;
+        thread_pool_detail::current_arena = &slots[index].arena;
+
+        while (true) {
+            if (timer_due()) {
+                fire_timers();
+            }
+
+            if (has_bounded_queue() && !stop.load(std::memory_order_relaxed) &&
+                !paused.load(std::memory_order_relaxed)) {
+                if (thread_pool_detail::TaskFunction task;
+                    bounded_queue->try_pop(task)) {
+                    notify_blocked_producer();
+                    run_task(index, task);
+                    continue;
+                }
+            }
+
+            if (idle_policy() != IdlePolicy::Block) {
+                spin_for_work();
+            }
+
+            {
+                std::unique_lock<std::mutex> lock = lock_queue();
+
+                if (!stop && (paused || !shared_queue_has_work())) {
+                    if (retire_if_surplus(index)) {
+                        return;
+                    }
+
+                    if (idle_policy() == IdlePolicy::Spin) {
+                        continue;
+                    }
+
+                    if (!park(lock, index, [this]() {
+                            return stop.load(std::memory_order_relaxed) ||
+                                   (!paused.load(std::memory_order_relaxed) &&
+                                    shared_queue_has_work());
+                        })) {
+                        return;
+                    }
+                }
+
+                if (stop) {
+                    return;
+                }
+                if (paused) {
+                    continue;
+                }
+
+                drain_staging_buffers(index);
+                WorkQueue* queue =
+                    has_bounded_queue() ? nullptr : find_work_queue(index);
+                if (queue == nullptr) {
+                    continue;
+                }
+
+                auto work_item = queue->pop();
+
+                lock.unlock();
+                run_task(index, work_item.task);
+            }
+        }
+    }
+
+    void work_stealing_loop(Worker& self, std::size_t index) {
+        current_pool = this;
+        current_worker = &self;
+        current_slot = index;
+        thread_pool_detail::current_arena = &slots[index].arena;
+
+        // Every so often look at the shared queue first, so externally
+        // submitted tasks are not starved by workers that keep feeding their
+        // own deques.
+        constexpr std::size_t shared_queue_interval = 32;
+        std::size_t tick = 0;
+
+        while (true) {
+            if (timer_due()) {
+                fire_timers();
+            }
+
+            if (!paused.load(std::memory_order_relaxed) &&
+                ++tick % shared_queue_interval != 0) {
+                LocalTask* task = self.deque.pop();
+                if (task == nullptr) {
+                    task = steal_task(self);
+                }
+
+                if (task != nullptr) {
+                    run_task(index, *task);
+                    delete_local_task(task);
+                    continue;
+                }
+            }
+
+            if (has_bounded_queue() && !stop.load(std::memory_order_relaxed) &&
+                !paused.load(std::memory_order_relaxed)) {
+                if (thread_pool_detail::TaskFunction task;
+                    bounded_queue->try_pop(task)) {
+                    notify_blocked_producer();
+                    run_task(index, task);
+                    continue;
+                }
+            }
+
+            if (idle_policy() != IdlePolicy::Block) {
+                spin_for_work();
+            }
+
+            std::unique_lock<std::mutex> lock = lock_queue();
+
+            if (!stop && (paused || (!shared_queue_has_work() &&
+                                     !has_stealable_work()))) {
+                if (retire_if_surplus(index)) {
+                    return;
+                }
+
+                if (idle_policy() == IdlePolicy::Spin) {
+                    continue;
+                }
+
+                if (!park(lock, index, [this]() {
+                        return stop.load(std::memory_order_relaxed) ||
+                               (!paused.load(std::memory_order_relaxed) &&
+                                (shared_queue_has_work() ||
+                                 has_stealable_work()));
+                    })) {
+                    return;
+                }
+            }
+
+            if (stop) {
+                return;
+            }
+            if (paused) {
+                continue;
+            }
+
+            drain_staging_buffers(index);
+            WorkQueue* queue =
+                has_bounded_queue() ? nullptr : find_work_queue(index);
+            if (queue != nullptr) {
+                auto work_item = queue->pop();
+                lock.unlock();
+                run_task(index, work_item.task);
+            }
+        }
+    }
+
+    static LocalTask* new_local_task(LocalTask task) {
+        void* block = thread_pool_detail::SlabAllocator::allocate(
+            sizeof(LocalTask));
+        return ::new (block) LocalTask(std::move(task));
+    }
+
+    static void delete_local_task(LocalTask* task) {
+        task->~LocalTask();
+        thread_pool_detail::SlabAllocator::deallocate(task, sizeof(LocalTask));
+    }
+
+    LocalTask* steal_task(Worker& self) {
+        // xorshift64, only used to pick a random starting victim.
+        self.rng ^= self.rng << 13;
+        self.rng ^= self.rng >> 7;
+        self.rng ^= self.rng << 17;
+
+        const std::size_t start = self.rng % max_threads;
+        for (std::size_t i = 0; i < max_threads; ++i) {
+            Worker& victim = *workers[(start + i) % max_threads];
+            if (&victim == &self) {
+                continue;
+            }
+
+            if (LocalTask* task = victim.deque.steal()) {
+                if constexpr (EnableStats) {
+                    counters[current_slot].steals.fetch_add(
+                        1, std::memory_order_relaxed);
+                }
+                return task;
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool has_stealable_work() const {
+        for (const auto& worker : workers) {
+            if (!worker->deque.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Polls for work before the caller parks. Returns once work shows up,
+    // the pool stops or, unless the policy is IdlePolicy::Spin, the spin and
+    // yield budget runs out.
+    void spin_for_work() {
+        if (has_work_hint()) {
+            return;
+        }
+
+        spinning_workers.fetch_add(1, std::memory_order_relaxed);
+
+        std::size_t spins = 0;
+        std::size_t yields = 0;
+        while (!has_work_hint() && !stop.load(std::memory_order_relaxed)) {
+            if (spins < options.spin_count) {
+                ++spins;
+                thread_pool_detail::cpu_relax();
+                continue;
+            }
+
+            if (idle_policy() == IdlePolicy::Spin) {
+                spins = 0;
+            } else if (yields++ == options.yield_count) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+
+        spinning_workers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Lock-free and possibly stale, a false positive only costs a trip
+    // through the lock.
+    bool has_work_hint() const {
+        if (timer_due()) {
+            return true;
+        }
+        if (paused.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        if (queued_task_count() > 0) {
+            return true;
+        }
+
+        if constexpr (EnableWorkStealing) {
+            return has_stealable_work();
+        }
+        return false;
+    }
+
+    // Wakes one parked worker after a push that did not take the lock.
+    // Busy pools skip the lock entirely.
+    void notify_idle_worker() {
+        if (idle_workers.load(std::memory_order_seq_cst) > 0) {
+            WorkerSlot* slot = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                slot = unpark_worker();
+            }
+
+            if (slot != nullptr) {
+                slot->wake.release();
+            }
+        }
+    }
+
+  private:
+    static constexpr std::size_t staging_capacity = 256;
+    static constexpr std::size_t cache_line_size =
+        thread_pool_detail::cache_line_size;
+
+    // Fixed at construction, only read afterwards.
+    const std::size_t min_threads;
+    const std::size_t max_threads;
+    const bool elastic;
+    ThreadPoolOptions options;
+    // One per NUMA node with numa_local_queues, otherwise just one.
+    std::unique_ptr<WorkQueue[]> work_queues;
+    std::size_t queue_count = 1;
+    std::unique_ptr<BoundedQueue> bounded_queue;
+    // See ThreadPoolOptions::submission_shards, empty without them.
+    std::vector<std::unique_ptr<BoundedQueue>> staging_buffers;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::unique_ptr<WorkerSlot[]> slots;
+    // max_threads + 1 entries with EnableStats, the last for threads outside
+    // the pool; null otherwise.
+    std::unique_ptr<thread_pool_detail::WorkerCounters[]> counters;
+    const Deadline timer_origin = std::chrono::steady_clock::now();
+
+    // queue_mutex and the state it guards. It starts a new cache line, so
+    // threads spinning on the lock do not slow down lock-free readers of
+    // the fields above and below.
+    alignas(cache_line_size) mutable std::mutex queue_mutex;
+    std::size_t target_threads;
+    // One per slot, threads of retired workers are joined when their slot
+    // is reused or the pool is destroyed.
     std::vector<std::thread> threads;
-    WorkQueue work_queue;
-    mutable std::mutex queue_mutex;
-    std::condition_variable cv;
-    bool stop = false;
-    std::size_t tasks_running;
+    // parked_workers lists the slots whose worker waits on its wake signal,
+    // idle_workers mirrors its size for lock-free readers.
+    std::vector<std::size_t> parked_workers;
+    ExceptionHandler exception_handler;
+    // Replaced by every cancel_all.
+    std::stop_source cancel_source;
+    // Producers waiting for room in bounded_queue.
+    std::condition_variable space_cv;
+    // timer_keeper is the parked worker whose wait ends at the next timer
+    // event, if any.
+    thread_pool_detail::TimerWheel<thread_pool_detail::TaskFunction> timers;
+    std::size_t timer_keeper = no_timer_keeper;
+    // See submit_blocking_task. blocking_pool is set once, under
+    // queue_mutex; blocking_lane_ptr publishes it to lock-free readers.
+    std::once_flag blocking_lane_created;
+    std::unique_ptr<BlockingLane> blocking_pool;
+
+    // Read by every submission or every turn of a worker loop, and only
+    // written when the pool changes state. stop and paused only change
+    // under queue_mutex, they are read without it as a hint.
+    alignas(cache_line_size) std::atomic<bool> stop = false;
+    std::atomic<bool> paused = false;
+    std::atomic<std::size_t> idle_workers = 0;
+    // steady_clock time of the next timer event for lock-free readers.
+    std::atomic<std::int64_t> next_timer = no_timer;
+    std::atomic<TraceHooks*> trace_hooks = nullptr;
+    std::atomic<BlockingLane*> blocking_lane_ptr = nullptr;
+
+    // Written whenever a worker starts, parks, wakes, spins or retires.
+    // live_threads and tasks_running only change under queue_mutex, they
+    // are atomic for thread_count() and get_tasks_running().
+    alignas(cache_line_size) std::atomic<std::size_t> live_threads = 0;
+    std::atomic<std::size_t> tasks_running = 0;
+    std::atomic<std::size_t> spinning_workers = 0;
+    std::atomic<std::size_t> blocked_producers = 0;
+
+    // Only written by traced submissions and late tasks.
+    alignas(cache_line_size) std::atomic<std::uint64_t> next_task_id = 1;
+    std::atomic<std::size_t> missed_deadline_count = 0;
+
+    // Submitted tasks that have not finished, on its own cache line since
+    // every submission and completion touches it.
+    alignas(cache_line_size) std::atomic<std::size_t> unfinished_tasks = 0;
 };
+
+// Policies for PolicyThreadPool, one of each kind at most, in any order.
+// Each kind left out takes the first default listed.
+namespace thread_pool_policy {
+    struct QueueKind {};
+    struct WaitKind {};
+    struct StatsKind {};
+    struct ExceptionKind {};
+
+    // Where queued tasks live.
+    struct PriorityQueue {
+        using kind = QueueKind;
+        static constexpr bool priority_scheduling = true;
+        static constexpr bool work_stealing = false;
+        static constexpr std::size_t capacity = 0;
+    };
+    struct FifoQueue {
+        using kind = QueueKind;
+        static constexpr bool priority_scheduling = false;
+        static constexpr bool work_stealing = false;
+        static constexpr std::size_t capacity = 0;
+    };
+    // The lock-free ring buffer, see ThreadPoolOptions::queue_capacity.
+    template <std::size_t Capacity = 1024>
+    struct BoundedFifoQueue {
+        static_assert(Capacity != 0, "A bounded queue needs a capacity");
+        using kind = QueueKind;
+        static constexpr bool priority_scheduling = false;
+        static constexpr bool work_stealing = false;
+        static constexpr std::size_t capacity = Capacity;
+    };
+    struct WorkStealingQueue {
+        using kind = QueueKind;
+        static constexpr bool priority_scheduling = false;
+        static constexpr bool work_stealing = true;
+        static constexpr std::size_t capacity = 0;
+    };
+
+    // What idle workers do, see IdlePolicy. OptionsWait leaves it to
+    // ThreadPoolOptions::idle_policy.
+    struct OptionsWait {
+        using kind = WaitKind;
+        static constexpr bool fixed = false;
+        static constexpr IdlePolicy idle_policy = IdlePolicy::Block;
+    };
+    template <IdlePolicy Policy>
+    struct FixedWait {
+        using kind = WaitKind;
+        static constexpr bool fixed = true;
+        static constexpr IdlePolicy idle_policy = Policy;
+    };
+    using BlockingWait = FixedWait<IdlePolicy::Block>;
+    using SpinThenParkWait = FixedWait<IdlePolicy::SpinThenPark>;
+    using SpinWait = FixedWait<IdlePolicy::Spin>;
+
+    struct NoStats {
+        using kind = StatsKind;
+        static constexpr bool enabled = false;
+    };
+    struct CollectStats {
+        using kind = StatsKind;
+        static constexpr bool enabled = true;
+    };
+
+    // What becomes of exceptions escaping detached tasks.
+    struct ForwardExceptions {
+        using kind = ExceptionKind;
+        static constexpr bool forward = true;
+    };
+    struct DiscardExceptions {
+        using kind = ExceptionKind;
+        static constexpr bool forward = false;
+    };
+}  // namespace thread_pool_policy
+
+namespace thread_pool_detail {
+    template <typename Kind, typename Default, typename... Policies>
+    struct SelectPolicy {
+        using type = Default;
+    };
+
+    template <typename Kind,
+              typename Default,
+              typename First,
+              typename... Rest>
+    struct SelectPolicy<Kind, Default, First, Rest...> {
+        using type =
+            std::conditional_t<std::is_same_v<typename First::kind, Kind>,
+                               First,
+                               typename SelectPolicy<Kind, Default, Rest...>::
+                                   type>;
+    };
+
+    template <typename... Policies>
+    struct ComposePolicies {
+        template <typename Kind>
+        static constexpr std::size_t count =
+            (std::size_t{0} + ... +
+             std::is_same_v<typename Policies::kind, Kind>);
+
+        static_assert(count<thread_pool_policy::QueueKind> <= 1 &&
+                          count<thread_pool_policy::WaitKind> <= 1 &&
+                          count<thread_pool_policy::StatsKind> <= 1 &&
+                          count<thread_pool_policy::ExceptionKind> <= 1,
+                      "At most one policy of each kind");
+
+        using Queue =
+            typename SelectPolicy<thread_pool_policy::QueueKind,
+                                  thread_pool_policy::PriorityQueue,
+                                  Policies...>::type;
+        using Wait = typename SelectPolicy<thread_pool_policy::WaitKind,
+                                           thread_pool_policy::OptionsWait,
+                                           Policies...>::type;
+        using Stats = typename SelectPolicy<thread_pool_policy::StatsKind,
+                                            thread_pool_policy::NoStats,
+                                            Policies...>::type;
+        using Exceptions =
+            typename SelectPolicy<thread_pool_policy::ExceptionKind,
+                                  thread_pool_policy::ForwardExceptions,
+                                  Policies...>::type;
+
+        struct Config {
+            static constexpr std::size_t queue_capacity = Queue::capacity;
+            static constexpr bool fixed_idle_policy = Wait::fixed;
+            static constexpr IdlePolicy idle_policy = Wait::idle_policy;
+            static constexpr bool forward_exceptions = Exceptions::forward;
+        };
+
+        // So policies that only pick the three flags name the same type
+        // as ThreadPool<...> does.
+        static constexpr bool default_config =
+            Config::queue_capacity == DefaultConfig::queue_capacity &&
+            Config::fixed_idle_policy == DefaultConfig::fixed_idle_policy &&
+            Config::forward_exceptions == DefaultConfig::forward_exceptions;
+
+        using type = ThreadPool<
+            Queue::priority_scheduling,
+            Queue::work_stealing,
+            Stats::enabled,
+            std::conditional_t<default_config, DefaultConfig, Config>>;
+    };
+}  // namespace thread_pool_detail
+
+// A ThreadPool put together from policies, each deciding at compile time
+// what would otherwise be a branch on ThreadPoolOptions in the hot path:
+//
+//     // Latency tier: lock-free FIFO, spinning workers, nothing recorded.
+//     using LatencyPool = PolicyThreadPool<
+//         thread_pool_policy::BoundedFifoQueue<4096>,
+//         thread_pool_policy::SpinWait>;
+//     // Batch tier: priorities, parked workers, full statistics.
+//     using BatchPool = PolicyThreadPool<thread_pool_policy::PriorityQueue,
+//                                        thread_pool_policy::BlockingWait,
+//                                        thread_pool_policy::CollectStats>;
+//
+// Policies that only pick the three flags give plain ThreadPool<...>, e.g.
+// with none at all it is ThreadPool<>.
+template <typename... Policies>
+using PolicyThreadPool =
+    typename thread_pool_detail::ComposePolicies<Policies...>::type;
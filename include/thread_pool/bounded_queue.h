@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread_pool/cache_line.h>
+#include <utility>
+
+namespace thread_pool_detail {
+    // Bounded lock-free multi-producer multi-consumer queue (Dmitry Vyukov's
+    // array-based design). Every slot carries a sequence number telling
+    // producers and consumers whose turn it is, so push and pop are a single
+    // CAS on the shared position plus a store to the slot. Slots sit on their
+    // own cache lines. Capacity is rounded up to a power of two.
+    template <typename T>
+    class BoundedQueue {
+        struct alignas(cache_line_size) Cell {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+
+      public:
+        explicit BoundedQueue(std::size_t requested_capacity)
+            : capacity{round_up_to_power_of_two(requested_capacity)},
+              mask{capacity - 1},
+              cells{new Cell[capacity]} {
+            for (std::size_t i = 0; i < capacity; ++i) {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        // Moves value into the queue unless it is full, in which case value
+        // is left untouched.
+        bool try_push(T& value) {
+            Cell* cell;
+            std::size_t position = enqueue_position.load(
+                std::memory_order_relaxed);
+
+            while (true) {
+                cell = &cells[position & mask];
+                const std::size_t sequence =
+                    cell->sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::intptr_t>(sequence) -
+                                        static_cast<std::intptr_t>(position);
+
+                if (difference == 0) {
+                    if (enqueue_position.compare_exchange_weak(
+                            position,
+                            position + 1,
+                            std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = enqueue_position.load(
+                        std::memory_order_relaxed);
+                }
+            }
+
+            cell->value = std::move(value);
+            // seq_cst: callers check for sleeping consumers after pushing.
+            cell->sequence.store(position + 1, std::memory_order_seq_cst);
+            return true;
+        }
+
+        bool try_pop(T& value) {
+            Cell* cell;
+            std::size_t position = dequeue_position.load(
+                std::memory_order_relaxed);
+
+            while (true) {
+                cell = &cells[position & mask];
+                const std::size_t sequence =
+                    cell->sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::intptr_t>(sequence) -
+                                        static_cast<std::intptr_t>(
+                                            position + 1);
+
+                if (difference == 0) {
+                    if (dequeue_position.compare_exchange_weak(
+                            position,
+                            position + 1,
+                            std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = dequeue_position.load(
+                        std::memory_order_relaxed);
+                }
+            }
+
+            value = std::move(cell->value);
+            // seq_cst: callers check for blocked producers after popping.
+            cell->sequence.store(position + capacity,
+                                 std::memory_order_seq_cst);
+            return true;
+        }
+
+        // True when the next slot to be consumed has not been published yet.
+        bool empty() const {
+            const std::size_t position = dequeue_position.load(
+                std::memory_order_seq_cst);
+            return cells[position & mask].sequence.load(
+                       std::memory_order_seq_cst) != position + 1;
+        }
+
+        // True when the next slot to be produced has not been released yet.
+        bool full() const {
+            const std::size_t position = enqueue_position.load(
+                std::memory_order_seq_cst);
+            return cells[position & mask].sequence.load(
+                       std::memory_order_seq_cst) != position;
+        }
+
+        std::size_t size() const {
+            const std::size_t head = dequeue_position.load(
+                std::memory_order_relaxed);
+            const std::size_t tail = enqueue_position.load(
+                std::memory_order_relaxed);
+            return tail > head ? tail - head : 0;
+        }
+
+        std::size_t max_size() const {
+            return capacity;
+        }
+
+      private:
+        static std::size_t round_up_to_power_of_two(std::size_t value) {
+            std::size_t result = 2;
+            while (result < value) {
+                result <<= 1;
+            }
+            return result;
+        }
+
+        const std::size_t capacity;
+        const std::size_t mask;
+        std::unique_ptr<Cell[]> cells;
+
+        alignas(cache_line_size) std::atomic<std::size_t> enqueue_position{0};
+        alignas(cache_line_size) std::atomic<std::size_t> dequeue_position{0};
+    };
+}  // namespace thread_pool_detail
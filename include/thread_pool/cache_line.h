@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+namespace thread_pool_detail {
+    // Alignment that keeps data written by different threads on separate
+    // cache lines. std::hardware_destructive_interference_size would give
+    // the same value on common targets, but it can change with -mtune, and
+    // translation units built with different flags would then disagree on
+    // the layout of the pool.
+    inline constexpr std::size_t cache_line_size = 64;
+}  // namespace thread_pool_detail
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdexcept>
+
+// Reported by the future of a task that was cancelled before it started.
+class TaskCancelledError : public std::runtime_error {
+  public:
+    TaskCancelledError()
+        : std::runtime_error("ThreadPool task was cancelled") {}
+};
+
+namespace thread_pool_detail {
+    // Set while ThreadPool::cancel_all discards queued tasks. Task wrappers
+    // check it and complete with TaskCancelledError instead of doing their
+    // work, so every future and continuation still finishes.
+    inline thread_local constinit bool cancelling = false;
+}  // namespace thread_pool_detail
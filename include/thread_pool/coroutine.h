@@ -0,0 +1,214 @@
+#pragma once
+
+#include <concepts>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <thread_pool/cancellation.h>
+#include <thread_pool/future.h>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+template <typename T>
+class Task;
+
+namespace thread_pool_detail {
+    // Awaiter returned by ThreadPool::schedule: suspends the coroutine and
+    // queues its resumption on the pool. A resumption discarded by
+    // cancel_all throws TaskCancelledError out of the co_await.
+    template <typename Pool>
+    class ScheduleAwaiter {
+      public:
+        explicit ScheduleAwaiter(Pool& pool) : pool{pool} {}
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            pool.post([this, handle]() {
+                cancelled = cancelling;
+                handle.resume();
+            });
+        }
+
+        void await_resume() const {
+            if (cancelled) {
+                throw TaskCancelledError();
+            }
+        }
+
+      private:
+        Pool& pool;
+        bool cancelled = false;
+    };
+
+    template <typename T>
+    struct TaskPromiseBase {
+        template <typename U>
+            requires std::convertible_to<U, T>
+        void return_value(U&& value) {
+            result.value.emplace(std::forward<U>(value));
+        }
+
+        FutureResult<T> result;
+    };
+
+    template <>
+    struct TaskPromiseBase<void> {
+        void return_void() {
+            result.value.emplace();
+        }
+
+        FutureResult<void> result;
+    };
+
+    // Coroutine started as soon as it is created and never awaited, used to
+    // drive a Task into a FutureState.
+    struct DetachedCoroutine {
+        struct promise_type {
+            DetachedCoroutine get_return_object() noexcept {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() noexcept {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept {
+                return {};
+            }
+
+            void return_void() noexcept {}
+
+            void unhandled_exception() noexcept {
+                std::terminate();
+            }
+        };
+    };
+
+    template <typename Pool, typename T>
+    DetachedCoroutine drive_task(Pool& pool,
+                                 Task<T> task,
+                                 std::shared_ptr<FutureState<T>> state) {
+        FutureResult<T> result;
+        try {
+            co_await pool.schedule();
+            if constexpr (std::is_void_v<T>) {
+                co_await std::move(task);
+                result.value.emplace();
+            } else {
+                result.value.emplace(co_await std::move(task));
+            }
+        } catch (...) {
+            result.exception = std::current_exception();
+        }
+        state->set_result(std::move(result));
+    }
+}  // namespace thread_pool_detail
+
+// Lazily started coroutine producing a T. Awaiting it starts the body on
+// the awaiting thread, and the awaiter resumes on whichever thread the body
+// finishes on, which is a pool worker once the body has hopped there with
+// co_await pool.schedule(). Run one from ordinary code with
+// ThreadPool::submit_coroutine.
+template <typename T = void>
+class [[nodiscard]] Task {
+  public:
+    class promise_type;
+
+  private:
+    using Handle = std::coroutine_handle<promise_type>;
+
+  public:
+    class promise_type : public thread_pool_detail::TaskPromiseBase<T> {
+      public:
+        Task get_return_object() noexcept {
+            return Task{Handle::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        // Transfers straight to the awaiting coroutine instead of resuming
+        // it from inside this frame, so long await chains use no stack.
+        auto final_suspend() noexcept {
+            struct FinalAwaiter {
+                bool await_ready() const noexcept {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(
+                    std::coroutine_handle<promise_type> handle) noexcept {
+                    std::coroutine_handle<> continuation =
+                        handle.promise().continuation;
+                    return continuation ? continuation
+                                        : std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept {}
+            };
+            return FinalAwaiter{};
+        }
+
+        void unhandled_exception() noexcept {
+            this->result.exception = std::current_exception();
+        }
+
+      private:
+        friend class Task;
+
+        std::coroutine_handle<> continuation;
+    };
+
+    Task(Task&& other) noexcept
+        : handle{std::exchange(other.handle, nullptr)} {}
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            Handle handle;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(
+                std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() {
+                return handle.promise().result.get();
+            }
+        };
+        return Awaiter{handle};
+    }
+
+  private:
+    explicit Task(Handle handle) : handle{handle} {}
+
+    Handle handle;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace thread_pool_detail {
+    // Spin-wait hint: tells the core we are busy-waiting, which saves power
+    // and frees execution resources for a hyperthread sibling.
+    inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+}  // namespace thread_pool_detail
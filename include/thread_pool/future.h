@@ -0,0 +1,480 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread_pool/cancellation.h>
+#include <thread_pool/task_function.h>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// What when_any completes with: the position of the first future to finish
+// and its value.
+template <typename T>
+struct WhenAnyResult {
+    std::size_t index;
+    T value;
+};
+
+template <>
+struct WhenAnyResult<void> {
+    std::size_t index;
+};
+
+template <typename T>
+class Future;
+
+namespace thread_pool_detail {
+    // What a finished task produced: a value, or the exception it threw.
+    template <typename T>
+    struct FutureResult {
+        using Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+        std::optional<Value> value;
+        std::exception_ptr exception;
+
+        T get() {
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+            if constexpr (!std::is_void_v<T>) {
+                return std::move(*value);
+            }
+        }
+    };
+
+    // Calls f and stores what it returns or throws.
+    template <typename T, typename F>
+    FutureResult<T> capture_result(F&& f) {
+        FutureResult<T> result;
+        try {
+            if constexpr (std::is_void_v<T>) {
+                std::invoke(std::forward<F>(f));
+                result.value.emplace();
+            } else {
+                result.value.emplace(std::invoke(std::forward<F>(f)));
+            }
+        } catch (...) {
+            result.exception = std::current_exception();
+        }
+        return result;
+    }
+
+    // Shared by a Future and the task that completes it. The result is
+    // either waited for, or handed to one callback on the completing thread,
+    // so continuations never occupy a thread while they wait.
+    template <typename T>
+    class FutureState {
+      public:
+        void set_result(FutureResult<T> new_result) {
+            TaskFunction pending;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                result = std::move(new_result);
+                ready.store(true, std::memory_order_release);
+                pending = std::move(callback);
+            }
+            ready_cv.notify_all();
+
+            if (pending) {
+                pending();
+            }
+        }
+
+        template <typename F>
+        void fulfill(F&& f) {
+            set_result(capture_result<T>(std::forward<F>(f)));
+        }
+
+        // Runs callback right away if the result is already there, otherwise
+        // on the thread that sets it. The callback should take the result;
+        // only one may be registered.
+        void on_complete(TaskFunction new_callback) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!ready.load(std::memory_order_relaxed)) {
+                    callback = std::move(new_callback);
+                    return;
+                }
+            }
+            new_callback();
+        }
+
+        bool is_ready() const {
+            return ready.load(std::memory_order_acquire);
+        }
+
+        void wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready_cv.wait(lock, [this]() {
+                return ready.load(std::memory_order_relaxed);
+            });
+        }
+
+        template <typename Rep, typename Period>
+        bool wait_for(const std::chrono::duration<Rep, Period>& timeout) {
+            std::unique_lock<std::mutex> lock(mutex);
+            return ready_cv.wait_for(lock, timeout, [this]() {
+                return ready.load(std::memory_order_relaxed);
+            });
+        }
+
+        // Only valid once ready.
+        FutureResult<T> take_result() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return std::move(result);
+        }
+
+      private:
+        std::mutex mutex;
+        std::condition_variable ready_cv;
+        std::atomic<bool> ready = false;
+        FutureResult<T> result;
+        TaskFunction callback;
+    };
+
+    template <typename T>
+    using FutureValue = typename FutureResult<T>::Value;
+
+    template <typename T>
+    using WhenAllResult =
+        std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+    // What f returns when called with the value of a Future<T>.
+    template <typename T, typename F>
+    struct ContinuationResult {
+        using type = std::invoke_result_t<F&, T>;
+    };
+
+    template <typename F>
+    struct ContinuationResult<void, F> {
+        using type = std::invoke_result_t<F&>;
+    };
+}  // namespace thread_pool_detail
+
+template <typename T>
+Future<thread_pool_detail::WhenAllResult<T>> when_all(
+    std::vector<Future<T>> futures);
+
+template <typename T>
+Future<WhenAnyResult<T>> when_any(std::vector<Future<T>> futures);
+
+// Future whose continuations are scheduled by the completing task instead
+// of a waiting thread. Created by ThreadPool::submit_future. Move-only, and
+// get, then, when_all and when_any each consume it.
+template <typename T>
+class Future {
+    using State = thread_pool_detail::FutureState<T>;
+
+  public:
+    Future() = default;
+
+    explicit Future(std::shared_ptr<State> state) : state{std::move(state)} {}
+
+    bool valid() const {
+        return state != nullptr;
+    }
+
+    bool is_ready() const {
+        return state->is_ready();
+    }
+
+    void wait() const {
+        state->wait();
+    }
+
+    template <typename Rep, typename Period>
+    std::future_status wait_for(
+        const std::chrono::duration<Rep, Period>& timeout) const {
+        if (state->is_ready()) {
+            return std::future_status::ready;
+        }
+        return state->wait_for(timeout) ? std::future_status::ready
+                                        : std::future_status::timeout;
+    }
+
+    // Blocks until the result is there, then returns it or rethrows the
+    // task's exception. Avoid calling it from a pool task; chain with then
+    // or use ThreadPool::wait instead.
+    T get() {
+        std::shared_ptr<State> finished = std::move(state);
+        finished->wait();
+        return finished->take_result().get();
+    }
+
+    // Once this future completes, submits f(value) (or f() for void) to
+    // pool. An exception from this future skips f and is passed on to the
+    // returned one.
+    template <typename Pool,
+              typename F,
+              typename ResultType =
+                  typename thread_pool_detail::ContinuationResult<T, F>::type>
+    Future<ResultType> then(Pool& pool, F&& f) && {
+        auto next = std::make_shared<thread_pool_detail::FutureState<
+            ResultType>>();
+        Future<ResultType> result(next);
+
+        std::move(*this).on_complete(
+            [&pool, next, f = std::forward<F>(f)](
+                thread_pool_detail::FutureResult<T> input) mutable {
+                // An exception is passed on from a pool task as well, so a
+                // long chain does not unwind recursively on this thread.
+                pool.post([next = std::move(next),
+                                  f = std::move(f),
+                                  input = std::move(input)]() mutable {
+                    if (input.exception) {
+                        next->set_result({std::nullopt, input.exception});
+                        return;
+                    }
+                    if (thread_pool_detail::cancelling) {
+                        next->set_result({std::nullopt,
+                                          std::make_exception_ptr(
+                                              TaskCancelledError())});
+                        return;
+                    }
+                    next->fulfill([&]() -> ResultType {
+                        if constexpr (std::is_void_v<T>) {
+                            return std::invoke(f);
+                        } else {
+                            return std::invoke(f, std::move(*input.value));
+                        }
+                    });
+                });
+            });
+
+        return result;
+    }
+
+    // Suspends the awaiting coroutine until the result is there. It resumes
+    // on the thread that completes the future, or right away without
+    // suspending if the result arrives while it is being suspended.
+    auto operator co_await() && {
+        struct Awaiter {
+            Future future;
+            thread_pool_detail::FutureResult<T> result;
+            // Set by whichever of await_suspend and the callback comes
+            // second, which then resumes the coroutine.
+            std::atomic<bool> handed_over = false;
+
+            bool await_ready() const {
+                return future.is_ready();
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                std::move(future).on_complete(
+                    [this, handle](thread_pool_detail::FutureResult<T> input) {
+                        result = std::move(input);
+                        if (handed_over.exchange(true,
+                                                 std::memory_order_acq_rel)) {
+                            handle.resume();
+                        }
+                    });
+                return !handed_over.exchange(true, std::memory_order_acq_rel);
+            }
+
+            T await_resume() {
+                if (future.valid()) {
+                    result = future.state->take_result();
+                }
+                return result.get();
+            }
+        };
+        return Awaiter{std::move(*this), {}};
+    }
+
+  private:
+    template <typename>
+    friend class Future;
+
+    template <typename U>
+    friend Future<thread_pool_detail::WhenAllResult<U>> when_all(
+        std::vector<Future<U>> futures);
+
+    template <typename U>
+    friend Future<WhenAnyResult<U>> when_any(std::vector<Future<U>> futures);
+
+    // The result moves out of the state on the completing thread, so the
+    // state does not need to outlive the callback.
+    template <typename Callback>
+    void on_complete(Callback&& callback) && {
+        State* source = state.get();
+        std::shared_ptr<State> keep = std::move(state);
+        keep->on_complete(
+            [source, callback = std::forward<Callback>(callback)]() mutable {
+                callback(source->take_result());
+            });
+    }
+
+    std::shared_ptr<State> state;
+};
+
+// Completes a Future from outside the pool, e.g. from an I/O callback. A
+// promise destroyed without a result completes its future with
+// std::future_errc::broken_promise.
+template <typename T>
+class Promise {
+    using State = thread_pool_detail::FutureState<T>;
+
+  public:
+    Promise() : state{std::make_shared<State>()} {}
+
+    Promise(Promise&&) noexcept = default;
+    Promise& operator=(Promise&& other) noexcept {
+        if (this != &other) {
+            abandon();
+            state = std::move(other.state);
+            satisfied = other.satisfied;
+        }
+        return *this;
+    }
+
+    ~Promise() {
+        abandon();
+    }
+
+    // May be called once.
+    Future<T> get_future() {
+        return Future<T>(state);
+    }
+
+    template <typename... Args>
+    void set_value(Args&&... args) {
+        thread_pool_detail::FutureResult<T> result;
+        result.value.emplace(std::forward<Args>(args)...);
+        complete(std::move(result));
+    }
+
+    void set_exception(std::exception_ptr exception) {
+        complete({std::nullopt, std::move(exception)});
+    }
+
+  private:
+    void complete(thread_pool_detail::FutureResult<T> result) {
+        satisfied = true;
+        state->set_result(std::move(result));
+    }
+
+    void abandon() {
+        if (state && !satisfied) {
+            set_exception(std::make_exception_ptr(
+                std::future_error(std::future_errc::broken_promise)));
+        }
+    }
+
+    std::shared_ptr<State> state;
+    bool satisfied = false;
+};
+
+// Completes once every future has, with their values in order, or with the
+// first exception any of them threw.
+template <typename T>
+Future<thread_pool_detail::WhenAllResult<T>> when_all(
+    std::vector<Future<T>> futures) {
+    using ResultType = thread_pool_detail::WhenAllResult<T>;
+
+    struct Join {
+        std::vector<std::optional<thread_pool_detail::FutureValue<T>>> values;
+        std::atomic<std::size_t> remaining;
+        std::mutex exception_mutex;
+        std::exception_ptr exception;
+        std::shared_ptr<thread_pool_detail::FutureState<ResultType>> state;
+    };
+
+    auto join = std::make_shared<Join>();
+    join->values.resize(futures.size());
+    join->remaining.store(futures.size(), std::memory_order_relaxed);
+    join->state =
+        std::make_shared<thread_pool_detail::FutureState<ResultType>>();
+    Future<ResultType> result(join->state);
+
+    auto finish = [](Join& join) {
+        if (join.exception) {
+            join.state->set_result({std::nullopt, join.exception});
+            return;
+        }
+        join.state->fulfill([&join]() -> ResultType {
+            if constexpr (!std::is_void_v<T>) {
+                std::vector<T> values;
+                values.reserve(join.values.size());
+                for (auto& value : join.values) {
+                    values.push_back(std::move(*value));
+                }
+                return values;
+            }
+        });
+    };
+
+    if (futures.empty()) {
+        finish(*join);
+        return result;
+    }
+
+    for (std::size_t i = 0; i < futures.size(); ++i) {
+        std::move(futures[i])
+            .on_complete([join, i, finish](
+                             thread_pool_detail::FutureResult<T> input) {
+                if (input.exception) {
+                    std::lock_guard<std::mutex> lock(join->exception_mutex);
+                    if (!join->exception) {
+                        join->exception = input.exception;
+                    }
+                } else {
+                    join->values[i] = std::move(input.value);
+                }
+
+                // acq_rel: the last one to finish reads every value.
+                if (join->remaining.fetch_sub(1, std::memory_order_acq_rel) ==
+                    1) {
+                    finish(*join);
+                }
+            });
+    }
+    return result;
+}
+
+// Completes with the first future to finish, or with its exception. The
+// others still run, their results are discarded.
+template <typename T>
+Future<WhenAnyResult<T>> when_any(std::vector<Future<T>> futures) {
+    if (futures.empty()) {
+        throw std::invalid_argument("when_any needs at least one future");
+    }
+
+    auto state =
+        std::make_shared<thread_pool_detail::FutureState<WhenAnyResult<T>>>();
+    auto won = std::make_shared<std::atomic<bool>>(false);
+    Future<WhenAnyResult<T>> result(state);
+
+    for (std::size_t i = 0; i < futures.size(); ++i) {
+        std::move(futures[i])
+            .on_complete([state, won, i](
+                             thread_pool_detail::FutureResult<T> input) {
+                if (won->exchange(true, std::memory_order_relaxed)) {
+                    return;
+                }
+                if (input.exception) {
+                    state->set_result({std::nullopt, input.exception});
+                    return;
+                }
+                state->fulfill([&]() -> WhenAnyResult<T> {
+                    if constexpr (std::is_void_v<T>) {
+                        return {i};
+                    } else {
+                        return {i, std::move(*input.value)};
+                    }
+                });
+            });
+    }
+    return result;
+}
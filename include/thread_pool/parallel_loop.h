@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// How parallel_for and parallel_reduce cut the iteration space into chunks.
+enum class ChunkPolicy {
+    // Equal chunks, one per participant.
+    Static,
+    // Chunks shrink with the remaining work: remaining / (2 * participants),
+    // but never below the grain size.
+    Guided,
+    // Lazy binary splitting: a participant keeps its range and only splits
+    // half of it off while workers are idle.
+    Auto,
+};
+
+namespace thread_pool_detail {
+    // Shared state of one parallel loop. Participants (the calling thread
+    // and any number of pool tasks) claim chunks of [0, size) and hand them
+    // to chunk_fn(first, last). Work is only ever waited for once it has been
+    // claimed, so the loop finishes even when no pool task gets to run.
+    template <typename ChunkFn>
+    class ParallelLoop {
+      public:
+        ParallelLoop(std::size_t size,
+                     ChunkFn& chunk_fn,
+                     ChunkPolicy policy,
+                     std::size_t participants,
+                     std::size_t grain_size)
+            : size{size},
+              chunk_fn{&chunk_fn},
+              policy{policy},
+              participants{std::max<std::size_t>(participants, 1)},
+              grain_size{grain_size != 0
+                             ? grain_size
+                             : std::max<std::size_t>(
+                                   size / (this->participants * 32), 1)} {
+            if (policy == ChunkPolicy::Auto && size > 0) {
+                pending.emplace_back(0, size);
+            }
+        }
+
+        // Number of extra participants worth starting up front.
+        std::size_t helpers_wanted() const {
+            if (policy == ChunkPolicy::Auto) {
+                return 0;
+            }
+            return std::min(participants - 1, chunk_count() - 1);
+        }
+
+        // Runs chunks until there is nothing left to claim. should_split()
+        // tells Auto whether splitting off work is worthwhile, spawn()
+        // schedules one more participant.
+        template <typename ShouldSplit, typename Spawn>
+        void participate(ShouldSplit&& should_split, Spawn&& spawn) {
+            std::size_t first;
+            std::size_t last;
+
+            if (policy != ChunkPolicy::Auto) {
+                while (claim(first, last)) {
+                    run(first, last);
+                }
+                return;
+            }
+
+            while (pop_pending(first, last)) {
+                while (last - first > grain_size) {
+                    if (!failed.load(std::memory_order_relaxed) &&
+                        should_split()) {
+                        const std::size_t middle = first + (last - first) / 2;
+                        {
+                            std::lock_guard<std::mutex> lock(pending_mutex);
+                            pending.emplace_back(middle, last);
+                        }
+                        spawn();
+                        last = middle;
+                        continue;
+                    }
+
+                    run(first, first + grain_size);
+                    first += grain_size;
+                }
+
+                run(first, last);
+            }
+        }
+
+        // Blocks until every iteration has completed and rethrows the first
+        // exception thrown by chunk_fn.
+        void wait() {
+            std::size_t done = completed.load(std::memory_order_acquire);
+            while (done != size) {
+                completed.wait(done, std::memory_order_acquire);
+                done = completed.load(std::memory_order_acquire);
+            }
+
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+        }
+
+      private:
+        std::size_t chunk_count() const {
+            const std::size_t chunk = static_chunk_size();
+            return std::max<std::size_t>((size + chunk - 1) / chunk, 1);
+        }
+
+        std::size_t static_chunk_size() const {
+            return std::max<std::size_t>(
+                (size + participants - 1) / participants, 1);
+        }
+
+        bool claim(std::size_t& first, std::size_t& last) {
+            if (policy == ChunkPolicy::Static) {
+                const std::size_t chunk = static_chunk_size();
+                first = next.fetch_add(chunk, std::memory_order_relaxed);
+                if (first >= size) {
+                    return false;
+                }
+                last = std::min(first + chunk, size);
+                return true;
+            }
+
+            first = next.load(std::memory_order_relaxed);
+            while (first < size) {
+                const std::size_t remaining = size - first;
+                const std::size_t chunk =
+                    std::min(std::max(remaining / (2 * participants),
+                                      grain_size),
+                             remaining);
+                if (next.compare_exchange_weak(first,
+                                               first + chunk,
+                                               std::memory_order_relaxed)) {
+                    last = first + chunk;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool pop_pending(std::size_t& first, std::size_t& last) {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            if (pending.empty()) {
+                return false;
+            }
+            std::tie(first, last) = pending.back();
+            pending.pop_back();
+            return true;
+        }
+
+        void run(std::size_t first, std::size_t last) {
+            // After a failure the remaining chunks are only accounted for.
+            if (!failed.load(std::memory_order_relaxed)) {
+                try {
+                    (*chunk_fn)(first, last);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(pending_mutex);
+                    if (!exception) {
+                        exception = std::current_exception();
+                    }
+                    failed.store(true, std::memory_order_relaxed);
+                }
+            }
+
+            const std::size_t count = last - first;
+            if (completed.fetch_add(count, std::memory_order_acq_rel) +
+                    count ==
+                size) {
+                completed.notify_all();
+            }
+        }
+
+        const std::size_t size;
+        ChunkFn* const chunk_fn;
+        const ChunkPolicy policy;
+        const std::size_t participants;
+        const std::size_t grain_size;
+
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> completed{0};
+        std::atomic<bool> failed{false};
+
+        std::mutex pending_mutex;
+        std::vector<std::pair<std::size_t, std::size_t>> pending;
+        std::exception_ptr exception;
+    };
+}  // namespace thread_pool_detail
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <thread_pool/cache_line.h>
+#include <utility>
+#include <vector>
+
+// One T per worker of a pool, each on its own cache line, so tasks can
+// accumulate into local() without atomics or shared lines and the results
+// are combined once the tasks are done. Threads that are not workers of
+// the pool, such as one helping in ThreadPool::wait, share one extra
+// slot, so only one of them may use local() at a time. Reading every slot
+// with combine or for_each is only safe once the tasks writing them have
+// finished, e.g. after wait_idle.
+template <typename T>
+class PerWorker {
+    struct alignas(thread_pool_detail::cache_line_size) Slot {
+        T value;
+    };
+
+  public:
+    template <typename Pool>
+    explicit PerWorker(const Pool& pool, const T& initial = T{})
+        : pool{&pool},
+          index_of{[](const void* target) {
+              return static_cast<const Pool*>(target)->current_worker_index();
+          }},
+          slots(pool.max_thread_count() + 1, Slot{initial}) {}
+
+    // The calling worker's value. no_worker maps to the extra last slot.
+    T& local() {
+        return slots[std::min(index_of(pool), slots.size() - 1)].value;
+    }
+
+    // Folds every slot's value into the first one's with op.
+    template <typename BinaryOp = std::plus<>>
+    T combine(BinaryOp op = {}) const {
+        T result = slots.front().value;
+        for (std::size_t i = 1; i < slots.size(); ++i) {
+            result = op(std::move(result), slots[i].value);
+        }
+        return result;
+    }
+
+    template <typename F>
+    void for_each(F&& f) {
+        for (Slot& slot : slots) {
+            f(slot.value);
+        }
+    }
+
+  private:
+    const void* pool;
+    std::size_t (*index_of)(const void*);
+    std::vector<Slot> slots;
+};
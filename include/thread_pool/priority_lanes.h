@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace thread_pool_detail {
+    // Priority queue over the 256 values of std::int8_t: one FIFO ring per
+    // priority plus a bitmap of the non-empty ones. push and pop are O(1)
+    // and tasks of equal priority come out in submission order. pop_aged
+    // additionally lets waiting entries climb one level per interval.
+    template <typename T>
+    class PriorityLanes {
+        static constexpr std::size_t lane_count = 256;
+        static constexpr std::size_t word_bits = 64;
+
+        struct Entry {
+            T value;
+            std::int64_t stamp;
+        };
+
+        // Growable ring buffer, capacity is zero or a power of two.
+        struct Lane {
+            std::vector<Entry> items;
+            std::size_t head = 0;
+            std::size_t count = 0;
+        };
+
+      public:
+        // stamp is only looked at by pop_aged.
+        void push(std::int8_t priority, T value, std::int64_t stamp = 0) {
+            const std::size_t index = lane_index(priority);
+            Lane& lane = lanes[index];
+
+            if (lane.count == lane.items.size()) {
+                grow(lane);
+            }
+
+            const std::size_t mask = lane.items.size() - 1;
+            lane.items[(lane.head + lane.count) & mask] = {std::move(value),
+                                                           stamp};
+            if (lane.count++ == 0) {
+                bitmap[index / word_bits] |= std::uint64_t{1}
+                                             << (index % word_bits);
+            }
+            ++total;
+        }
+
+        // Highest priority first. Must not be called when empty.
+        T pop() {
+            return pop_lane(highest_lane());
+        }
+
+        // Highest effective priority first, where an entry gains one level
+        // for every interval it has waited since its stamp. Costs one step
+        // per non-empty priority. Must not be called when empty.
+        T pop_aged(std::int64_t now, std::int64_t interval) {
+            std::size_t best = 0;
+            std::int64_t best_score = -1;
+
+            for (std::size_t word = bitmap.size(); word-- > 0;) {
+                std::uint64_t bits = bitmap[word];
+                while (bits != 0) {
+                    const std::size_t bit =
+                        word_bits - 1 -
+                        static_cast<std::size_t>(std::countl_zero(bits));
+                    bits &= ~(std::uint64_t{1} << bit);
+
+                    const std::size_t index = word * word_bits + bit;
+                    const Lane& lane = lanes[index];
+                    const std::int64_t score =
+                        static_cast<std::int64_t>(index) +
+                        (now - lane.items[lane.head].stamp) / interval;
+                    // Strictly greater: ties go to the higher priority.
+                    if (score > best_score) {
+                        best = index;
+                        best_score = score;
+                    }
+                }
+            }
+
+            return pop_lane(best);
+        }
+
+        bool empty() const {
+            return total == 0;
+        }
+
+        std::size_t size() const {
+            return total;
+        }
+
+      private:
+        static std::size_t lane_index(std::int8_t priority) {
+            return static_cast<std::size_t>(static_cast<int>(priority) + 128);
+        }
+
+        std::size_t highest_lane() const {
+            for (std::size_t word = bitmap.size(); word-- > 0;) {
+                if (bitmap[word] != 0) {
+                    return word * word_bits + word_bits - 1 -
+                           static_cast<std::size_t>(
+                               std::countl_zero(bitmap[word]));
+                }
+            }
+            return 0;
+        }
+
+        T pop_lane(std::size_t index) {
+            Lane& lane = lanes[index];
+
+            T value = std::move(lane.items[lane.head].value);
+            lane.head = (lane.head + 1) & (lane.items.size() - 1);
+            if (--lane.count == 0) {
+                bitmap[index / word_bits] &= ~(std::uint64_t{1}
+                                               << (index % word_bits));
+            }
+            --total;
+            return value;
+        }
+
+        static void grow(Lane& lane) {
+            const std::size_t capacity = lane.items.size();
+            std::vector<Entry> items(capacity == 0 ? 8 : capacity * 2);
+            for (std::size_t i = 0; i < lane.count; ++i) {
+                items[i] = std::move(lane.items[(lane.head + i) &
+                                                (capacity - 1)]);
+            }
+            lane.items = std::move(items);
+            lane.head = 0;
+        }
+
+        std::array<Lane, lane_count> lanes;
+        std::array<std::uint64_t, lane_count / word_bits> bitmap{};
+        std::size_t total = 0;
+    };
+}  // namespace thread_pool_detail
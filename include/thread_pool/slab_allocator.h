@@ -0,0 +1,241 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace thread_pool_detail {
+    // Fixed-size block pool used for task storage and promise shared states.
+    // Blocks come from per-thread caches, which exchange whole batches with a
+    // process-wide depot, so the steady state of a submit/complete cycle never
+    // reaches the global allocator. Blocks are carved out of chunks that are
+    // kept until the process exits, so every block below max_block_size is
+    // a whole block of its size class.
+    class SlabAllocator {
+        static constexpr std::size_t size_classes = 4;
+        static constexpr std::size_t min_block_size = 64;
+        static constexpr std::size_t batch_size = 64;
+
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+        struct Batch {
+            FreeBlock* head;
+            std::size_t count;
+        };
+
+        class Depot {
+          public:
+            Batch take(std::size_t size_class) {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto& batches = free_batches[size_class];
+
+                if (!batches.empty()) {
+                    Batch batch = batches.back();
+                    batches.pop_back();
+                    return batch;
+                }
+
+                // One chunk holds exactly one batch of blocks.
+                const std::size_t block_size = min_block_size << size_class;
+                auto* chunk = static_cast<std::byte*>(
+                    ::operator new(block_size * batch_size));
+                chunks.push_back(chunk);
+
+                Batch batch{};
+                for (std::size_t i = 0; i < batch_size; ++i) {
+                    auto* block = reinterpret_cast<FreeBlock*>(
+                        chunk + i * block_size);
+                    block->next = batch.head;
+                    batch.head = block;
+                }
+                batch.count = batch_size;
+                return batch;
+            }
+
+            void give(std::size_t size_class, Batch batch) {
+                std::lock_guard<std::mutex> lock(mutex);
+                free_batches[size_class].push_back(batch);
+            }
+
+            // For threads without a cache any more, one block at a time.
+            FreeBlock* take_one(std::size_t size_class) {
+                Batch batch = take(size_class);
+                FreeBlock* block = batch.head;
+                batch.head = block->next;
+                if (--batch.count > 0) {
+                    give(size_class, batch);
+                }
+                return block;
+            }
+
+            void give_one(std::size_t size_class, FreeBlock* block) {
+                block->next = nullptr;
+                give(size_class, Batch{block, 1});
+            }
+
+          private:
+            std::mutex mutex;
+            std::array<std::vector<Batch>, size_classes> free_batches;
+            std::vector<void*> chunks;
+        };
+
+        // Trivially destructible, so it stays usable while other thread_local
+        // objects are being torn down.
+        struct ThreadCache {
+            std::array<Batch, size_classes> lists;
+            bool torn_down;
+        };
+
+        // Hands the cached blocks of an exiting thread back to the depot.
+        struct ThreadCacheReaper {
+            ~ThreadCacheReaper() {
+                ThreadCache& cache = thread_cache;
+                cache.torn_down = true;
+
+                for (std::size_t i = 0; i < size_classes; ++i) {
+                    if (cache.lists[i].count > 0) {
+                        depot().give(i, cache.lists[i]);
+                        cache.lists[i] = Batch{};
+                    }
+                }
+            }
+        };
+
+        static inline thread_local constinit ThreadCache thread_cache{};
+        static inline thread_local ThreadCacheReaper reaper;
+
+        // Never destroyed, so threads that exit during static destruction
+        // can still return their blocks. Its chunks stay reachable until
+        // the process exits.
+        static Depot& depot() {
+            static Depot& instance = *new Depot;
+            return instance;
+        }
+
+        static constexpr std::size_t size_class_of(std::size_t size) {
+            std::size_t size_class = 0;
+            while ((min_block_size << size_class) < size) {
+                ++size_class;
+            }
+            return size_class;
+        }
+
+      public:
+        static constexpr std::size_t max_block_size = min_block_size
+                                                      << (size_classes - 1);
+
+        static void* allocate(std::size_t size) {
+            const std::size_t size_class = size_class_of(size);
+            ThreadCache& cache = thread_cache;
+
+            if (size_class >= size_classes) {
+                return ::operator new(size);
+            }
+
+            if (cache.torn_down) {
+                return depot().take_one(size_class);
+            }
+
+            Batch& list = cache.lists[size_class];
+            if (list.head == nullptr) {
+                // First use on this thread registers the reaper.
+                static_cast<void>(&reaper);
+                list = depot().take(size_class);
+            }
+
+            FreeBlock* block = list.head;
+            list.head = block->next;
+            --list.count;
+            return block;
+        }
+
+        // Blocks aligned beyond what operator new guarantees come from the
+        // global allocator instead.
+        static void* allocate(std::size_t size, std::size_t alignment) {
+            if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+                return ::operator new(size, std::align_val_t{alignment});
+            }
+            return allocate(size);
+        }
+
+        static void deallocate(void* pointer, std::size_t size) noexcept {
+            const std::size_t size_class = size_class_of(size);
+            ThreadCache& cache = thread_cache;
+
+            if (size_class >= size_classes) {
+                ::operator delete(pointer);
+                return;
+            }
+
+            if (cache.torn_down) {
+                // Too late to cache the block on this thread.
+                depot().give_one(size_class,
+                                 static_cast<FreeBlock*>(pointer));
+                return;
+            }
+
+            // Registers the reaper for threads that only ever free.
+            static_cast<void>(&reaper);
+
+            Batch& list = cache.lists[size_class];
+            auto* block = static_cast<FreeBlock*>(pointer);
+            block->next = list.head;
+            list.head = block;
+
+            // Keep at most two batches per thread so blocks freed on another
+            // thread than the one that allocated them flow back.
+            if (++list.count == 2 * batch_size) {
+                Batch batch{};
+                for (std::size_t i = 0; i < batch_size; ++i) {
+                    FreeBlock* moved = list.head;
+                    list.head = moved->next;
+                    moved->next = batch.head;
+                    batch.head = moved;
+                }
+                batch.count = batch_size;
+                list.count -= batch_size;
+                depot().give(size_class, batch);
+            }
+        }
+
+        static void deallocate(void* pointer,
+                               std::size_t size,
+                               std::size_t alignment) noexcept {
+            if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+                ::operator delete(pointer, std::align_val_t{alignment});
+                return;
+            }
+            deallocate(pointer, size);
+        }
+    };
+
+    // Standard allocator interface on top of SlabAllocator, used to give
+    // std::promise a pooled shared state.
+    template <typename T>
+    struct PoolAllocator {
+        using value_type = T;
+
+        PoolAllocator() = default;
+
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+        T* allocate(std::size_t n) {
+            return static_cast<T*>(
+                SlabAllocator::allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T* pointer, std::size_t n) noexcept {
+            SlabAllocator::deallocate(pointer, n * sizeof(T), alignof(T));
+        }
+
+        template <typename U>
+        bool operator==(const PoolAllocator<U>&) const noexcept {
+            return true;
+        }
+    };
+}  // namespace thread_pool_detail
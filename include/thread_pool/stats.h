@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread_pool/cache_line.h>
+#include <vector>
+
+namespace thread_pool_detail {
+    class AtomicLatencyHistogram;
+}
+
+// Histogram of durations with HDR-style log-linear buckets: values below
+// 16ns get a bucket each, and every power of two above that is split into
+// 16 buckets, so a percentile is off by at most 1/16 of its value.
+class LatencyHistogram {
+  public:
+    static constexpr std::size_t sub_buckets = 16;
+    static constexpr std::size_t bucket_count = 61 * sub_buckets;
+
+    void record(std::chrono::nanoseconds value) {
+        const std::uint64_t ns = to_ns(value);
+        ++counts[bucket_index(ns)];
+        ++total;
+        sum += ns;
+        maximum = std::max(maximum, ns);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (std::size_t bucket = 0; bucket < bucket_count; ++bucket) {
+            counts[bucket] += other.counts[bucket];
+        }
+        total += other.total;
+        sum += other.sum;
+        maximum = std::max(maximum, other.maximum);
+    }
+
+    std::uint64_t count() const {
+        return total;
+    }
+
+    std::chrono::nanoseconds mean() const {
+        return std::chrono::nanoseconds(total == 0 ? 0 : sum / total);
+    }
+
+    std::chrono::nanoseconds max() const {
+        return std::chrono::nanoseconds(maximum);
+    }
+
+    // Value that percent of the recordings do not exceed, e.g.
+    // percentile(99.0) for p99, rounded up to its bucket's upper bound.
+    std::chrono::nanoseconds percentile(double percent) const {
+        if (total == 0) {
+            return std::chrono::nanoseconds(0);
+        }
+
+        const double rank = std::clamp(percent, 0.0, 100.0) / 100.0 * total;
+        const std::uint64_t wanted =
+            std::max<std::uint64_t>(static_cast<std::uint64_t>(rank), 1);
+        std::uint64_t seen = 0;
+        for (std::size_t bucket = 0; bucket < bucket_count; ++bucket) {
+            seen += counts[bucket];
+            if (seen >= wanted) {
+                return std::chrono::nanoseconds(
+                    std::min(bucket_upper_bound(bucket), maximum));
+            }
+        }
+        return max();
+    }
+
+    static std::size_t bucket_index(std::uint64_t value) {
+        if (value < sub_buckets) {
+            return static_cast<std::size_t>(value);
+        }
+        // The top 5 bits of value: the leading one and 4 below it.
+        const unsigned shift =
+            static_cast<unsigned>(std::bit_width(value)) - 5;
+        return (shift + 1) * sub_buckets +
+               static_cast<std::size_t>((value >> shift) - sub_buckets);
+    }
+
+    static std::uint64_t bucket_upper_bound(std::size_t index) {
+        if (index < sub_buckets) {
+            return index;
+        }
+        const std::size_t shift = index / sub_buckets - 1;
+        const std::uint64_t mantissa = sub_buckets + index % sub_buckets;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+  private:
+    friend class thread_pool_detail::AtomicLatencyHistogram;
+
+    static std::uint64_t to_ns(std::chrono::nanoseconds value) {
+        return static_cast<std::uint64_t>(
+            std::max<std::chrono::nanoseconds::rep>(value.count(), 0));
+    }
+
+    std::array<std::uint64_t, bucket_count> counts{};
+    std::uint64_t total = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t maximum = 0;
+};
+
+// Counters of one worker since the pool started. idle_time is the time
+// spent parked, not counting spinning before that. lock_waits counts the
+// times the worker found the pool's queue lock taken, and lock_wait_time
+// is how long it waited for it in total.
+struct WorkerStats {
+    std::uint64_t tasks_executed = 0;
+    std::uint64_t steals = 0;
+    std::uint64_t parks = 0;
+    std::chrono::nanoseconds idle_time{0};
+    std::chrono::nanoseconds busy_time{0};
+    std::uint64_t lock_waits = 0;
+    std::chrono::nanoseconds lock_wait_time{0};
+};
+
+// Load of one lane: the pool's own workers, or its blocking lane. Only
+// parked time counts as idle.
+struct LaneStats {
+    // Live threads, and how many of them are not idle right now.
+    std::size_t threads = 0;
+    std::size_t busy_threads = 0;
+    std::chrono::nanoseconds busy_time{0};
+    std::chrono::nanoseconds idle_time{0};
+
+    // Share of the lane's busy and idle time spent running tasks.
+    double utilization() const {
+        const auto total = busy_time + idle_time;
+        return total.count() > 0 ? static_cast<double>(busy_time.count()) /
+                                       static_cast<double>(total.count())
+                                 : 0.0;
+    }
+};
+
+// Snapshot returned by ThreadPool::get_stats. It is read without locking
+// while tasks keep running, so its fields need not add up exactly.
+struct ThreadPoolStats {
+    // One entry per worker slot, including slots an elastic pool has not
+    // started threads for.
+    std::vector<WorkerStats> workers;
+    // Tasks run by threads outside the pool, in ThreadPool::wait or inline
+    // when a bounded queue is full.
+    std::uint64_t tasks_executed_by_callers = 0;
+    // Like WorkerStats::lock_waits, for every thread outside the pool
+    // submitting to it.
+    std::uint64_t caller_lock_waits = 0;
+    std::chrono::nanoseconds caller_lock_wait_time{0};
+    std::size_t queued_tasks = 0;
+    std::size_t unfinished_tasks = 0;
+    // From submission until the task started.
+    LatencyHistogram queue_wait;
+    LatencyHistogram run_time;
+    // Everything above is about the compute lane only.
+    LaneStats compute;
+    LaneStats blocking;
+};
+
+namespace thread_pool_detail {
+    // LatencyHistogram that several threads can record into with relaxed
+    // atomics, meant to be written by one thread most of the time.
+    class AtomicLatencyHistogram {
+      public:
+        void record(std::chrono::nanoseconds value) {
+            const std::uint64_t ns = LatencyHistogram::to_ns(value);
+            counts[LatencyHistogram::bucket_index(ns)].fetch_add(
+                1, std::memory_order_relaxed);
+            sum.fetch_add(ns, std::memory_order_relaxed);
+
+            std::uint64_t current = maximum.load(std::memory_order_relaxed);
+            while (ns > current &&
+                   !maximum.compare_exchange_weak(
+                       current, ns, std::memory_order_relaxed)) {
+            }
+        }
+
+        void add_to(LatencyHistogram& histogram) const {
+            for (std::size_t bucket = 0;
+                 bucket < LatencyHistogram::bucket_count;
+                 ++bucket) {
+                const std::uint64_t count =
+                    counts[bucket].load(std::memory_order_relaxed);
+                histogram.counts[bucket] += count;
+                histogram.total += count;
+            }
+            histogram.sum += sum.load(std::memory_order_relaxed);
+            histogram.maximum = std::max(
+                histogram.maximum, maximum.load(std::memory_order_relaxed));
+        }
+
+      private:
+        std::array<std::atomic<std::uint64_t>, LatencyHistogram::bucket_count>
+            counts{};
+        std::atomic<std::uint64_t> sum = 0;
+        std::atomic<std::uint64_t> maximum = 0;
+    };
+
+    struct alignas(cache_line_size) WorkerCounters {
+        std::atomic<std::uint64_t> tasks_executed = 0;
+        std::atomic<std::uint64_t> steals = 0;
+        std::atomic<std::uint64_t> parks = 0;
+        std::atomic<std::int64_t> idle_ns = 0;
+        std::atomic<std::int64_t> busy_ns = 0;
+        std::atomic<std::uint64_t> lock_waits = 0;
+        std::atomic<std::int64_t> lock_wait_ns = 0;
+        AtomicLatencyHistogram queue_wait;
+        AtomicLatencyHistogram run_time;
+    };
+}  // namespace thread_pool_detail
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+#include <thread_pool/cache_line.h>
+#include <thread_pool/cancellation.h>
+#include <thread_pool/cpu_relax.h>
+#include <thread_pool/future.h>
+#include <thread_pool/slab_allocator.h>
+#include <thread_pool/task_function.h>
+#include <type_traits>
+#include <utility>
+
+// Runs the tasks given to it one at a time, in the order they were
+// submitted, on the workers of a pool. Tasks on different strands run in
+// parallel, so per-key state (a connection, a session) owned by one strand
+// needs no lock. Submitting is lock-free. While a strand has work one pool
+// task runs it, so consecutive tasks stay on the same worker; after
+// max_batch of them it requeues itself to let other work through. Copies
+// share the same queue, and queued tasks keep it alive, but the pool must
+// outlive them. A submission the pool rejects, e.g. with QueueFullError
+// from a full bounded queue, throws and leaves the strand usable.
+template <typename Pool>
+class Strand {
+  public:
+    static constexpr std::size_t max_batch = 64;
+
+    explicit Strand(Pool& pool) : state{std::make_shared<State>(pool)} {}
+
+    // Like ThreadPool::submit_future. Tasks still queued when the pool's
+    // cancel_all runs report TaskCancelledError.
+    template <typename F,
+              typename... Args,
+              typename ResultType = std::invoke_result_t<F, Args...>>
+        requires std::invocable<F, Args...>
+    Future<ResultType> submit_future(F&& f, Args&&... args) {
+        auto result_state =
+            std::make_shared<thread_pool_detail::FutureState<ResultType>>();
+        Future<ResultType> result(result_state);
+
+        push([result_state = std::move(result_state),
+              f = std::forward<F>(f),
+              ... args = std::forward<Args>(args)]() mutable {
+            if (thread_pool_detail::cancelling) {
+                result_state->set_result(
+                    {std::nullopt,
+                     std::make_exception_ptr(TaskCancelledError())});
+                return;
+            }
+            result_state->fulfill(
+                [&]() -> ResultType { return std::invoke(f, args...); });
+        });
+        return result;
+    }
+
+    // Like ThreadPool::detach_task: an exception escaping f is passed to
+    // the pool's exception handler, and the next task runs as usual.
+    template <typename F, typename... Args>
+        requires std::invocable<F, Args...>
+    void detach_task(F&& f, Args&&... args) {
+        push([f = std::forward<F>(f),
+              ... args = std::forward<Args>(args)]() mutable {
+            if (!thread_pool_detail::cancelling) {
+                std::invoke(f, args...);
+            }
+        });
+    }
+
+  private:
+    struct Node {
+        std::atomic<Node*> next = nullptr;
+        thread_pool_detail::TaskFunction task;
+    };
+
+    // Vyukov's intrusive multi-producer single-consumer queue: producers
+    // swap themselves in as the tail, and the one task running the strand
+    // is the only consumer. The node last popped stays behind as the dummy
+    // head. pending counts tasks that have not finished, raised before
+    // their node is published, and whoever raises it from zero schedules
+    // the strand.
+    struct State {
+        explicit State(Pool& pool) : pool{pool} {}
+
+        State(const State&) = delete;
+        State& operator=(const State&) = delete;
+
+        ~State() {
+            if (head != &stub) {
+                delete_node(head);
+            }
+        }
+
+        Pool& pool;
+        Node stub;
+        Node* head = &stub;
+        alignas(thread_pool_detail::cache_line_size) std::atomic<Node*> tail =
+            &stub;
+        std::atomic<std::size_t> pending = 0;
+    };
+
+    // The strand is scheduled before the node is published, so a rejected
+    // task never reaches the queue and the tasks of other producers are
+    // left alone.
+    void push(thread_pool_detail::TaskFunction task) {
+        void* block =
+            thread_pool_detail::SlabAllocator::allocate(sizeof(Node));
+        Node* node = ::new (block) Node{nullptr, std::move(task)};
+
+        if (state->pending.fetch_add(1, std::memory_order_acq_rel) == 0) {
+            try {
+                schedule(state);
+            } catch (...) {
+                // E.g. QueueFullError from a bounded queue
+                delete_node(node);
+                withdraw(state);
+                throw;
+            }
+        }
+
+        Node* previous = state->tail.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // post, so a strand discarded by cancel_all still runs, cancelling each
+    // of its tasks, and pending returns to zero. state is copied, so the
+    // caller still holds it when post throws.
+    static void schedule(const std::shared_ptr<State>& state) {
+        state->pool.post([state]() mutable { run(std::move(state)); });
+    }
+
+    // Takes back the pending count of a task whose schedule failed in push.
+    // Nobody runs the strand then, so tasks pushed since, which were
+    // accepted, are requeued, or run right here while the queue stays
+    // full. Their exceptions are then dropped, as this thread has no
+    // exception handler to pass them to.
+    static void withdraw(const std::shared_ptr<State>& state) {
+        if (state->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            return;
+        }
+
+        try {
+            schedule(state);
+        } catch (...) {
+            try {
+                run(state);
+            } catch (...) {
+            }
+        }
+    }
+
+    // Requeues itself after max_batch tasks, or right after a task that
+    // threw, and otherwise returns once no task is pending. A requeue that
+    // fails, e.g. on a full bounded queue, keeps the strand running here
+    // instead.
+    static void run(std::shared_ptr<State> state) {
+        std::exception_ptr exception;
+        while (run_batch(*state, exception)) {
+            try {
+                schedule(state);
+                break;
+            } catch (...) {
+            }
+        }
+
+        // Rethrown for post to hand to the exception handler, after the
+        // rest of the strand is on its way.
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    // Runs up to max_batch tasks and returns whether more are pending. It
+    // stops early after a task that threw. Only the first exception is
+    // kept, later ones are dropped.
+    static bool run_batch(State& state, std::exception_ptr& exception) {
+        for (std::size_t i = 0; i < max_batch; ++i) {
+            thread_pool_detail::TaskFunction task = pop(state);
+
+            bool threw = false;
+            try {
+                task();
+            } catch (...) {
+                threw = true;
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+            }
+            task = {};
+
+            if (state.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                return false;
+            }
+            if (threw) {
+                return true;
+            }
+        }
+        return true;
+    }
+
+    // Only called while a task is pending. Its producer may not have
+    // swapped in the tail or linked it yet, which takes a few instructions
+    // unless it was preempted in between.
+    static thread_pool_detail::TaskFunction pop(State& state) {
+        Node* next = state.head->next.load(std::memory_order_acquire);
+        for (std::size_t spins = 0; next == nullptr; ++spins) {
+            if (spins < 64) {
+                thread_pool_detail::cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+            next = state.head->next.load(std::memory_order_acquire);
+        }
+
+        if (state.head != &state.stub) {
+            delete_node(state.head);
+        }
+        state.head = next;
+        return std::move(next->task);
+    }
+
+    static void delete_node(Node* node) {
+        node->~Node();
+        thread_pool_detail::SlabAllocator::deallocate(node, sizeof(Node));
+    }
+
+    std::shared_ptr<State> state;
+};
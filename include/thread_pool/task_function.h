@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <thread_pool/slab_allocator.h>
+#include <type_traits>
+#include <utility>
+
+namespace thread_pool_detail {
+    // Move-only type-erased void() callable. Callables up to inline_size
+    // bytes live inside the object, larger ones in a SlabAllocator block, so
+    // wrapping a task does not touch the global allocator.
+    class TaskFunction {
+      public:
+        static constexpr std::size_t inline_size = 64;
+
+        TaskFunction() = default;
+
+        template <typename F>
+            requires(!std::is_same_v<std::decay_t<F>, TaskFunction> &&
+                     std::is_invocable_v<std::decay_t<F>&>)
+        TaskFunction(F&& f) {
+            using Callable = std::decay_t<F>;
+
+            if constexpr (stored_inline<Callable>) {
+                ::new (static_cast<void*>(storage))
+                    Callable(std::forward<F>(f));
+            } else {
+                void* block = SlabAllocator::allocate(sizeof(Callable),
+                                                      alignof(Callable));
+                try {
+                    ::new (block) Callable(std::forward<F>(f));
+                } catch (...) {
+                    SlabAllocator::deallocate(
+                        block, sizeof(Callable), alignof(Callable));
+                    throw;
+                }
+                ::new (static_cast<void*>(storage)) void*(block);
+            }
+
+            operations = &operations_for<Callable>;
+        }
+
+        TaskFunction(TaskFunction&& other) noexcept
+            : operations{other.operations} {
+            if (operations != nullptr) {
+                operations->relocate(storage, other.storage);
+                other.operations = nullptr;
+            }
+        }
+
+        TaskFunction& operator=(TaskFunction&& other) noexcept {
+            if (this != &other) {
+                reset();
+                operations = other.operations;
+                if (operations != nullptr) {
+                    operations->relocate(storage, other.storage);
+                    other.operations = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        TaskFunction(const TaskFunction&) = delete;
+        TaskFunction& operator=(const TaskFunction&) = delete;
+
+        ~TaskFunction() {
+            reset();
+        }
+
+        void operator()() {
+            operations->invoke(storage);
+        }
+
+        explicit operator bool() const noexcept {
+            return operations != nullptr;
+        }
+
+      private:
+        struct Operations {
+            void (*invoke)(void* storage);
+            // Moves the callable from source into the uninitialized
+            // destination and destroys what is left in source.
+            void (*relocate)(void* destination, void* source) noexcept;
+            void (*destroy)(void* storage) noexcept;
+        };
+
+        template <typename Callable>
+        static constexpr bool stored_inline =
+            sizeof(Callable) <= inline_size &&
+            alignof(Callable) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible_v<Callable>;
+
+        template <typename Callable>
+        static Callable* target(void* storage) {
+            if constexpr (stored_inline<Callable>) {
+                return std::launder(static_cast<Callable*>(storage));
+            } else {
+                return static_cast<Callable*>(
+                    *std::launder(static_cast<void**>(storage)));
+            }
+        }
+
+        template <typename Callable>
+        static constexpr Operations operations_for{
+            [](void* storage) { (*target<Callable>(storage))(); },
+            [](void* destination, void* source) noexcept {
+                if constexpr (stored_inline<Callable>) {
+                    Callable* callable = target<Callable>(source);
+                    ::new (destination) Callable(std::move(*callable));
+                    callable->~Callable();
+                } else {
+                    ::new (destination) void*(target<Callable>(source));
+                }
+            },
+            [](void* storage) noexcept {
+                Callable* callable = target<Callable>(storage);
+                callable->~Callable();
+                if constexpr (!stored_inline<Callable>) {
+                    SlabAllocator::deallocate(
+                        callable, sizeof(Callable), alignof(Callable));
+                }
+            },
+        };
+
+        void reset() noexcept {
+            if (operations != nullptr) {
+                operations->destroy(storage);
+                operations = nullptr;
+            }
+        }
+
+        alignas(std::max_align_t) unsigned char storage[inline_size];
+        const Operations* operations = nullptr;
+    };
+}  // namespace thread_pool_detail
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread_pool/cancellation.h>
+#include <thread_pool/future.h>
+#include <thread_pool/task_function.h>
+#include <utility>
+#include <vector>
+
+// Directed acyclic graph of tasks. A task is submitted by whichever of its
+// predecessors finishes last, so running a graph never blocks a worker.
+// A graph can be run again once the previous run has completed, and must
+// outlive its runs.
+class TaskGraph {
+  public:
+    using Node = std::size_t;
+
+    template <typename F>
+        requires std::invocable<F&>
+    Node add(F&& f) {
+        nodes.push_back(
+            {thread_pool_detail::TaskFunction(std::forward<F>(f)), {}, 0});
+        return nodes.size() - 1;
+    }
+
+    // after only starts once before has finished.
+    void precede(Node before, Node after) {
+        if (before >= nodes.size() || after >= nodes.size()) {
+            throw std::out_of_range("TaskGraph::precede: no such node");
+        }
+        nodes[before].successors.push_back(after);
+        ++nodes[after].predecessors;
+    }
+
+    std::size_t size() const {
+        return nodes.size();
+    }
+
+    // Submits every node without predecessors to pool. The returned future
+    // completes once all nodes have run, or rethrows the first exception a
+    // node threw. Nodes that depend on a failed node are skipped, as are
+    // nodes still queued when the pool's cancel_all runs.
+    template <typename Pool>
+    Future<void> run(Pool& pool) {
+        check_acyclic();
+
+        auto state = std::make_shared<thread_pool_detail::FutureState<void>>();
+        Future<void> result(state);
+        if (nodes.empty()) {
+            state->set_result({std::monostate{}, nullptr});
+            return result;
+        }
+
+        auto graph_run = std::make_shared<Run>(*this, std::move(state));
+        for (Node node = 0; node < nodes.size(); ++node) {
+            if (nodes[node].predecessors == 0) {
+                submit_node(pool, graph_run, node);
+            }
+        }
+        return result;
+    }
+
+  private:
+    struct NodeData {
+        thread_pool_detail::TaskFunction work;
+        std::vector<Node> successors;
+        std::size_t predecessors;
+    };
+
+    // State of one run, shared by its node tasks.
+    struct Run {
+        Run(TaskGraph& graph,
+            std::shared_ptr<thread_pool_detail::FutureState<void>> state)
+            : graph{graph},
+              pending{std::make_unique<std::atomic<std::size_t>[]>(
+                  graph.nodes.size())},
+              failed{std::make_unique<std::atomic<bool>[]>(
+                  graph.nodes.size())},
+              unfinished{graph.nodes.size()},
+              state{std::move(state)} {
+            for (Node node = 0; node < graph.nodes.size(); ++node) {
+                pending[node].store(graph.nodes[node].predecessors,
+                                    std::memory_order_relaxed);
+                failed[node].store(false, std::memory_order_relaxed);
+            }
+        }
+
+        TaskGraph& graph;
+        // Predecessors of each node that have not finished yet.
+        std::unique_ptr<std::atomic<std::size_t>[]> pending;
+        // Set when the node or one of its predecessors threw.
+        std::unique_ptr<std::atomic<bool>[]> failed;
+        std::atomic<std::size_t> unfinished;
+        std::mutex exception_mutex;
+        std::exception_ptr exception;
+        std::shared_ptr<thread_pool_detail::FutureState<void>> state;
+    };
+
+    template <typename Pool>
+    static void submit_node(Pool& pool,
+                            const std::shared_ptr<Run>& graph_run,
+                            Node node) {
+        pool.post([&pool, graph_run, node]() {
+            run_node(pool, graph_run, node);
+        });
+    }
+
+    template <typename Pool>
+    static void run_node(Pool& pool,
+                         const std::shared_ptr<Run>& graph_run,
+                         Node node) {
+        Run& run = *graph_run;
+        NodeData& data = run.graph.nodes[node];
+
+        // acquire pairs with the acq_rel decrement that released this node.
+        bool failed = run.failed[node].load(std::memory_order_acquire);
+        if (!failed) {
+            try {
+                if (thread_pool_detail::cancelling) {
+                    throw TaskCancelledError();
+                }
+                data.work();
+            } catch (...) {
+                failed = true;
+                std::lock_guard<std::mutex> lock(run.exception_mutex);
+                if (!run.exception) {
+                    run.exception = std::current_exception();
+                }
+            }
+        }
+
+        for (Node successor : data.successors) {
+            if (failed) {
+                run.failed[successor].store(true, std::memory_order_relaxed);
+            }
+            if (run.pending[successor].fetch_sub(
+                    1, std::memory_order_acq_rel) == 1) {
+                submit_node(pool, graph_run, successor);
+            }
+        }
+
+        if (run.unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            if (run.exception) {
+                run.state->set_result({std::nullopt, run.exception});
+            } else {
+                run.state->set_result({std::monostate{}, nullptr});
+            }
+        }
+    }
+
+    // Kahn's algorithm: every node must become ready at some point.
+    void check_acyclic() const {
+        std::vector<std::size_t> remaining(nodes.size());
+        std::vector<Node> ready;
+        for (Node node = 0; node < nodes.size(); ++node) {
+            remaining[node] = nodes[node].predecessors;
+            if (remaining[node] == 0) {
+                ready.push_back(node);
+            }
+        }
+
+        std::size_t visited = 0;
+        while (!ready.empty()) {
+            const Node node = ready.back();
+            ready.pop_back();
+            ++visited;
+            for (Node successor : nodes[node].successors) {
+                if (--remaining[successor] == 0) {
+                    ready.push_back(successor);
+                }
+            }
+        }
+
+        if (visited != nodes.size()) {
+            throw std::invalid_argument("TaskGraph contains a cycle");
+        }
+    }
+
+    std::vector<NodeData> nodes;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <thread_pool/cancellation.h>
+#include <utility>
+
+// Fork-join on a pool: run(f) spawns f as a child of the group, and wait()
+// returns once every child has finished, running queued tasks of the pool
+// meanwhile instead of blocking. Children need no future, and spawning
+// from a worker of a work-stealing pool pushes onto that worker's deque,
+// so a child nobody stole is popped and run inline by its own parent's
+// wait(). Once the pool holds max_queued unfinished tasks, run(f) calls f
+// right away instead, so deep recursions stop splitting when there is
+// plenty of work for every worker already. The first exception thrown by
+// a child is rethrown by wait(). When cancel_all discards children, wait()
+// reports TaskCancelledError. When the pool rejects a child, e.g. with
+// QueueFullError from a full bounded queue, run(f) throws and the group
+// carries on without it. A group may be reused after wait(), and must not
+// be destroyed while children are still pending.
+template <typename Pool>
+class TaskGroup {
+  public:
+    // 0 means four unfinished tasks per worker.
+    explicit TaskGroup(Pool& pool, std::size_t max_queued = 0)
+        : pool{pool},
+          max_queued{max_queued != 0 ? max_queued
+                                     : 4 * pool.max_thread_count()} {}
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    template <typename F>
+        requires std::invocable<F&>
+    void run(F&& f) {
+        if (pool.get_tasks_total() >= max_queued) {
+            invoke(f);
+            return;
+        }
+
+        pending.fetch_add(1, std::memory_order_relaxed);
+        try {
+            pool.post([this, f = std::forward<F>(f)]() mutable {
+                if (thread_pool_detail::cancelling) {
+                    fail(std::make_exception_ptr(TaskCancelledError()));
+                } else {
+                    invoke(f);
+                }
+                // Last, the group may be gone once pending reaches zero.
+                pending.fetch_sub(1, std::memory_order_release);
+            });
+        } catch (...) {
+            // E.g. QueueFullError from a bounded queue; f never runs.
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            throw;
+        }
+    }
+
+    void wait() {
+        pool.wait_until([this]() {
+            return pending.load(std::memory_order_acquire) == 0;
+        });
+
+        if (failed.load(std::memory_order_acquire)) {
+            std::exception_ptr rethrown = std::move(exception);
+            exception = nullptr;
+            failed.store(false, std::memory_order_relaxed);
+            claimed.store(false, std::memory_order_relaxed);
+            std::rethrow_exception(rethrown);
+        }
+    }
+
+  private:
+    template <typename F>
+    void invoke(F& f) {
+        try {
+            std::invoke(f);
+        } catch (...) {
+            fail(std::current_exception());
+        }
+    }
+
+    // Keeps the first exception. claimed lets exactly one child store it,
+    // failed publishes it to wait().
+    void fail(std::exception_ptr thrown) {
+        if (!claimed.exchange(true, std::memory_order_acq_rel)) {
+            exception = std::move(thrown);
+            failed.store(true, std::memory_order_release);
+        }
+    }
+
+    Pool& pool;
+    const std::size_t max_queued;
+    std::atomic<std::size_t> pending = 0;
+    std::atomic<bool> claimed = false;
+    std::atomic<bool> failed = false;
+    std::exception_ptr exception;
+};
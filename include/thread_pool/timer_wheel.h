@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace thread_pool_detail {
+    // Hierarchical timer wheel over integer ticks. Level L has 64 slots of
+    // 64^L ticks each, and an entry sits on the level of the highest 6-bit
+    // group in which its due tick differs from the current one, so adding
+    // is O(1). When time reaches a slot's start, its entries move down to
+    // the finer levels, at most once per level. A bitmap per level skips
+    // empty slots, so advancing over a long idle gap costs O(levels) per
+    // occupied slot instead of one step per tick. Eleven levels cover every
+    // 64-bit tick, so nothing ever overflows.
+    template <typename T>
+    class TimerWheel {
+        static constexpr unsigned slot_bits = 6;
+        static constexpr std::size_t slot_count = std::size_t{1} << slot_bits;
+        static constexpr unsigned levels = 11;
+
+        struct Entry {
+            std::uint64_t due;
+            T value;
+        };
+
+      public:
+        static constexpr std::uint64_t never =
+            std::numeric_limits<std::uint64_t>::max();
+
+        // An entry due at or before the current tick fires on the next
+        // advance.
+        void add(std::uint64_t due, T value) {
+            place({due, std::move(value)});
+            ++count;
+        }
+
+        // Moves time forward to target, calling on_due(value) for every
+        // entry due by then, earliest tick first.
+        template <typename F>
+        void advance(std::uint64_t target, F&& on_due) {
+            while (count != 0) {
+                fire(on_due);
+                if (current >= target || count == 0) {
+                    break;
+                }
+                current = next_tick(target);
+                cascade();
+            }
+            current = std::max(current, target);
+        }
+
+        // No entry is due before the returned tick, never when empty. It
+        // may be a slot start whose entries are due later; advancing to it
+        // then just moves them down a level.
+        std::uint64_t next_event() const {
+            if (count == 0) {
+                return never;
+            }
+            if (occupied[0] & (std::uint64_t{1} << slot_of(current, 0))) {
+                return current;
+            }
+            return next_tick(never);
+        }
+
+        // Removes every entry, calling on_entry(value) for each.
+        template <typename F>
+        void clear(F&& on_entry) {
+            for (unsigned level = 0; level < levels; ++level) {
+                for (std::size_t slot = 0; slot < slot_count; ++slot) {
+                    std::vector<Entry> entries = std::move(slots[level][slot]);
+                    slots[level][slot].clear();
+                    for (Entry& entry : entries) {
+                        on_entry(std::move(entry.value));
+                    }
+                }
+                occupied[level] = 0;
+            }
+            count = 0;
+        }
+
+        std::size_t size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+      private:
+        static unsigned shift(unsigned level) {
+            return level * slot_bits;
+        }
+
+        static std::size_t slot_of(std::uint64_t tick, unsigned level) {
+            return (tick >> shift(level)) & (slot_count - 1);
+        }
+
+        void place(Entry entry) {
+            unsigned level = 0;
+            std::size_t slot = slot_of(current, 0);
+            if (entry.due > current) {
+                level = (std::bit_width(entry.due ^ current) - 1) / slot_bits;
+                slot = slot_of(entry.due, level);
+            }
+            slots[level][slot].push_back(std::move(entry));
+            occupied[level] |= std::uint64_t{1} << slot;
+        }
+
+        // Runs the entries of the current tick's level 0 slot.
+        template <typename F>
+        void fire(F& on_due) {
+            const std::size_t slot = slot_of(current, 0);
+            if (!(occupied[0] & (std::uint64_t{1} << slot))) {
+                return;
+            }
+
+            std::vector<Entry> entries = std::move(slots[0][slot]);
+            slots[0][slot].clear();
+            occupied[0] &= ~(std::uint64_t{1} << slot);
+            count -= entries.size();
+            for (Entry& entry : entries) {
+                on_due(std::move(entry.value));
+            }
+        }
+
+        // Spreads the slots starting at the current tick over the levels
+        // below, coarsest first, so an entry can fall through several.
+        void cascade() {
+            for (unsigned level = levels - 1; level > 0; --level) {
+                const std::uint64_t below =
+                    (std::uint64_t{1} << shift(level)) - 1;
+                const std::size_t slot = slot_of(current, level);
+                if ((current & below) != 0 ||
+                    !(occupied[level] & (std::uint64_t{1} << slot))) {
+                    continue;
+                }
+
+                std::vector<Entry> entries = std::move(slots[level][slot]);
+                slots[level][slot].clear();
+                occupied[level] &= ~(std::uint64_t{1} << slot);
+                for (Entry& entry : entries) {
+                    place(std::move(entry));
+                }
+            }
+        }
+
+        // The next tick after the current one at which a slot starts that
+        // holds entries, or limit if that comes first. A level's later slots
+        // in the current rotation all start before any slot of a coarser
+        // level does.
+        std::uint64_t next_tick(std::uint64_t limit) const {
+            for (unsigned level = 0; level < levels; ++level) {
+                const std::size_t slot = slot_of(current, level);
+                const std::uint64_t later =
+                    slot + 1 == slot_count
+                        ? 0
+                        : occupied[level] & (~std::uint64_t{0} << (slot + 1));
+                if (later == 0) {
+                    continue;
+                }
+
+                const unsigned rotation = shift(level + 1);
+                const std::uint64_t base =
+                    rotation >= 64 ? 0 : current >> rotation << rotation;
+                const std::uint64_t tick =
+                    base | (std::uint64_t{static_cast<unsigned>(
+                                std::countr_zero(later))}
+                            << shift(level));
+                return std::min(tick, limit);
+            }
+            return limit;
+        }
+
+        std::vector<Entry> slots[levels][slot_count];
+        std::uint64_t occupied[levels] = {};
+        std::uint64_t current = 0;
+        std::size_t count = 0;
+    };
+}  // namespace thread_pool_detail
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace thread_pool_detail {
+    // CPUs grouped by NUMA node, read from sysfs on Linux. Elsewhere, or
+    // when sysfs is unavailable, all hardware threads form a single node.
+    class Topology {
+      public:
+        static const Topology& get() {
+            static const Topology instance;
+            return instance;
+        }
+
+        const std::vector<std::vector<unsigned>>& nodes() const {
+            return node_cpus;
+        }
+
+        std::size_t cpu_count() const {
+            std::size_t count = 0;
+            for (const auto& cpus : node_cpus) {
+                count += cpus.size();
+            }
+            return count;
+        }
+
+        std::size_t node_of(unsigned cpu) const {
+            return cpu < cpu_node.size() ? cpu_node[cpu] : 0;
+        }
+
+        // Node of the CPU the calling thread currently runs on.
+        std::size_t current_node() const {
+#if defined(__linux__)
+            if (node_cpus.size() > 1) {
+                const int cpu = sched_getcpu();
+                if (cpu >= 0) {
+                    return node_of(static_cast<unsigned>(cpu));
+                }
+            }
+#endif
+            return 0;
+        }
+
+      private:
+        Topology() {
+#if defined(__linux__)
+            for (std::size_t node = 0;; ++node) {
+                std::ifstream cpulist("/sys/devices/system/node/node" +
+                                      std::to_string(node) + "/cpulist");
+                if (!cpulist) {
+                    break;
+                }
+
+                std::string list;
+                std::getline(cpulist, list);
+                std::vector<unsigned> cpus = parse_cpu_list(list);
+                if (!cpus.empty()) {
+                    node_cpus.push_back(std::move(cpus));
+                }
+            }
+#endif
+
+            if (node_cpus.empty()) {
+                const unsigned count =
+                    std::max(std::thread::hardware_concurrency(), 1u);
+                node_cpus.emplace_back();
+                for (unsigned cpu = 0; cpu < count; ++cpu) {
+                    node_cpus.back().push_back(cpu);
+                }
+            }
+
+            for (std::size_t node = 0; node < node_cpus.size(); ++node) {
+                for (unsigned cpu : node_cpus[node]) {
+                    if (cpu >= cpu_node.size()) {
+                        cpu_node.resize(cpu + 1, 0);
+                    }
+                    cpu_node[cpu] = node;
+                }
+            }
+        }
+
+        // Parses the kernel's "0-3,8,10-11" format.
+        static std::vector<unsigned> parse_cpu_list(const std::string& list) {
+            std::vector<unsigned> cpus;
+            std::stringstream stream(list);
+            std::string range;
+
+            while (std::getline(stream, range, ',')) {
+                if (range.empty()) {
+                    continue;
+                }
+
+                const std::size_t dash = range.find('-');
+                const unsigned first =
+                    static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+                const unsigned last =
+                    dash == std::string::npos
+                        ? first
+                        : static_cast<unsigned>(
+                              std::stoul(range.substr(dash + 1)));
+                for (unsigned cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+            return cpus;
+        }
+
+        std::vector<std::vector<unsigned>> node_cpus;
+        std::vector<std::size_t> cpu_node;
+    };
+
+    // Restricts the calling thread to cpu. Returns false where pinning is
+    // not supported or the CPU is not available to the process.
+    inline bool pin_current_thread(unsigned cpu) {
+#if defined(__linux__)
+        if (cpu >= CPU_SETSIZE) {
+            return false;
+        }
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        static_cast<void>(cpu);
+        return false;
+#endif
+    }
+}  // namespace thread_pool_detail
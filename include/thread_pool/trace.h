@@ -0,0 +1,262 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <ios>
+#include <ostream>
+
+// Name shown for a task in traces. Pass it as the first argument of
+// submit_task or detach_task. The string must outlive the trace, which a
+// literal does.
+struct TaskName {
+    const char* value;
+};
+
+// Receives the pool's scheduling events, see ThreadPool::set_trace_hooks.
+// Called on the thread where the event happens, so overrides must be
+// thread safe and fast. worker is the index of the worker the event
+// happened on, or external for threads outside the pool. name is null for
+// unnamed tasks.
+class TraceHooks {
+  public:
+    static constexpr std::size_t external =
+        std::numeric_limits<std::size_t>::max();
+
+    virtual ~TraceHooks() = default;
+
+    virtual void on_submit(std::uint64_t, const char*, std::size_t) {}
+    virtual void on_start(std::uint64_t, const char*, std::size_t) {}
+    virtual void on_finish(std::uint64_t, const char*, std::size_t) {}
+    virtual void on_park(std::size_t) {}
+    virtual void on_wake(std::size_t) {}
+};
+
+namespace thread_pool_detail {
+    // Name for the tasks the current thread is submitting, set by the
+    // TaskName overloads for the duration of one submission.
+    inline thread_local constinit const char* submitting_task_name = nullptr;
+
+    class ScopedTaskName {
+      public:
+        explicit ScopedTaskName(TaskName name)
+            : previous{submitting_task_name} {
+            submitting_task_name = name.value;
+        }
+
+        ScopedTaskName(const ScopedTaskName&) = delete;
+        ScopedTaskName& operator=(const ScopedTaskName&) = delete;
+
+        ~ScopedTaskName() {
+            submitting_task_name = previous;
+        }
+
+      private:
+        const char* previous;
+    };
+}  // namespace thread_pool_detail
+
+// TraceHooks that keeps the most recent capacity events in a lock-free ring
+// buffer and writes them as Chrome trace JSON, which chrome://tracing and
+// the Perfetto UI both open. Recording an event takes no lock.
+class TraceRecorder : public TraceHooks {
+  public:
+    explicit TraceRecorder(std::size_t capacity = 1 << 16)
+        : mask{round_up_to_power_of_two(capacity) - 1},
+          events{std::make_unique<Event[]>(mask + 1)},
+          origin{std::chrono::steady_clock::now()} {}
+
+    void on_submit(std::uint64_t task,
+                   const char* name,
+                   std::size_t worker) override {
+        record(Type::Submit, task, name, worker);
+    }
+
+    void on_start(std::uint64_t task,
+                  const char* name,
+                  std::size_t worker) override {
+        record(Type::Start, task, name, worker);
+    }
+
+    void on_finish(std::uint64_t task,
+                   const char* name,
+                   std::size_t worker) override {
+        record(Type::Finish, task, name, worker);
+    }
+
+    void on_park(std::size_t worker) override {
+        record(Type::Park, 0, nullptr, worker);
+    }
+
+    void on_wake(std::size_t worker) override {
+        record(Type::Wake, 0, nullptr, worker);
+    }
+
+    // Events recorded so far, including overwritten ones.
+    std::uint64_t size() const {
+        return next.load(std::memory_order_relaxed);
+    }
+
+    // Tasks run as duration events on one track per worker, with a flow
+    // arrow from where each was submitted. Threads outside the pool get a
+    // track each. Call it once the traced pool is idle: events recorded
+    // meanwhile may be skipped.
+    void write_chrome_trace(std::ostream& out) const {
+        const std::uint64_t end = next.load(std::memory_order_acquire);
+        const std::uint64_t begin = end > mask + 1 ? end - (mask + 1) : 0;
+        const std::ios_base::fmtflags flags = out.flags();
+        const std::streamsize precision = out.precision();
+
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        auto separator = [&]() -> std::ostream& {
+            out << (first ? "\n" : ",\n");
+            first = false;
+            return out;
+        };
+
+        for (std::uint64_t ticket = begin; ticket < end; ++ticket) {
+            const Event& event = events[ticket & mask];
+            if (event.sequence.load(std::memory_order_acquire) != ticket + 1) {
+                continue;
+            }
+
+            const auto type = static_cast<Type>(
+                event.type.load(std::memory_order_acquire));
+            const std::uint64_t task =
+                event.task.load(std::memory_order_acquire);
+            const char* name = event.name.load(std::memory_order_acquire);
+            const std::uint64_t thread =
+                event.thread.load(std::memory_order_acquire);
+            const double timestamp =
+                static_cast<double>(
+                    event.time.load(std::memory_order_acquire)) /
+                1000.0;
+            if (event.sequence.load(std::memory_order_relaxed) != ticket + 1) {
+                continue;  // Overwritten while reading it
+            }
+
+            auto common = [&](const char* phase) {
+                separator() << "{\"ph\":\"" << phase << "\",\"pid\":0,\"tid\":"
+                            << thread << ",\"ts\":" << std::fixed
+                            << std::setprecision(3) << timestamp;
+            };
+            auto task_name = [&]() {
+                out << ",\"name\":\"";
+                write_escaped(out, name != nullptr ? name : "task");
+                out << "\"";
+            };
+
+            switch (type) {
+            case Type::Submit:
+                common("s");
+                task_name();
+                out << ",\"cat\":\"task\",\"id\":" << task << "}";
+                break;
+            case Type::Start:
+                common("B");
+                task_name();
+                out << ",\"args\":{\"id\":" << task << "}}";
+                common("f");
+                task_name();
+                out << ",\"cat\":\"task\",\"id\":" << task
+                    << ",\"bp\":\"e\"}";
+                break;
+            case Type::Finish:
+                common("E");
+                out << "}";
+                break;
+            case Type::Park:
+                common("B");
+                out << ",\"name\":\"parked\"}";
+                break;
+            case Type::Wake:
+                common("E");
+                out << "}";
+                break;
+            }
+        }
+
+        out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+  private:
+    enum class Type : std::uint8_t { Submit, Start, Finish, Park, Wake };
+
+    // Fields are atomics so a slot can be rewritten while it is read;
+    // sequence is ticket + 1 once the event in it is complete.
+    struct Event {
+        std::atomic<std::uint64_t> sequence = 0;
+        std::atomic<std::int64_t> time = 0;
+        std::atomic<std::uint64_t> task = 0;
+        std::atomic<const char*> name = nullptr;
+        std::atomic<std::uint64_t> thread = 0;
+        std::atomic<std::uint8_t> type = 0;
+    };
+
+    // Workers are tracks 0..n-1, other threads get numbers from 1000 up.
+    static std::uint64_t track(std::size_t worker) {
+        if (worker != external) {
+            return worker;
+        }
+        static std::atomic<std::uint64_t> next_external = 1000;
+        static thread_local const std::uint64_t id =
+            next_external.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+
+    void record(Type type,
+                std::uint64_t task,
+                const char* name,
+                std::size_t worker) {
+        const std::int64_t time =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - origin)
+                .count();
+        const std::uint64_t ticket =
+            next.fetch_add(1, std::memory_order_relaxed);
+
+        // A reader that sees any of the new fields also sees sequence reset,
+        // so it never mixes two events. On x86 the release stores are
+        // plain moves.
+        Event& event = events[ticket & mask];
+        event.sequence.exchange(0, std::memory_order_acquire);
+        event.time.store(time, std::memory_order_release);
+        event.task.store(task, std::memory_order_release);
+        event.name.store(name, std::memory_order_release);
+        event.thread.store(track(worker), std::memory_order_release);
+        event.type.store(static_cast<std::uint8_t>(type),
+                         std::memory_order_release);
+        event.sequence.store(ticket + 1, std::memory_order_release);
+    }
+
+    static void write_escaped(std::ostream& out, const char* text) {
+        for (; *text != '\0'; ++text) {
+            if (*text == '"' || *text == '\\') {
+                out << '\\';
+            }
+            if (static_cast<unsigned char>(*text) >= 0x20) {
+                out << *text;
+            }
+        }
+    }
+
+    static std::size_t round_up_to_power_of_two(std::size_t value) {
+        std::size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const std::size_t mask;
+    std::unique_ptr<Event[]> events;
+    const std::chrono::steady_clock::time_point origin;
+    std::atomic<std::uint64_t> next = 0;
+};
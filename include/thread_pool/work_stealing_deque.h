@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread_pool/cache_line.h>
+#include <vector>
+
+namespace thread_pool_detail {
+    // Chase-Lev work-stealing deque (Le et al., "Correct and Efficient
+    // Work-Stealing for Weak Memory Models"). The owning worker pushes and
+    // pops at the bottom, any other thread may steal from the top. Elements
+    // are stored as raw pointers so that slots can be read atomically. The
+    // fences of the paper are folded into seq_cst operations, which keeps the
+    // deque understandable to ThreadSanitizer.
+    template <typename T>
+    class WorkStealingDeque {
+        class Buffer {
+          public:
+            explicit Buffer(std::int64_t capacity)
+                : capacity{capacity},
+                  mask{capacity - 1},
+                  slots{new std::atomic<T*>[static_cast<std::size_t>(
+                      capacity)]} {}
+
+            std::int64_t size() const {
+                return capacity;
+            }
+
+            void put(std::int64_t index, T* item) {
+                slots[index & mask].store(item, std::memory_order_relaxed);
+            }
+
+            T* get(std::int64_t index) const {
+                return slots[index & mask].load(std::memory_order_relaxed);
+            }
+
+            Buffer* grow(std::int64_t bottom, std::int64_t top) const {
+                Buffer* buffer = new Buffer(capacity * 2);
+                for (std::int64_t i = top; i < bottom; ++i) {
+                    buffer->put(i, get(i));
+                }
+                return buffer;
+            }
+
+          private:
+            std::int64_t capacity;
+            std::int64_t mask;
+            std::unique_ptr<std::atomic<T*>[]> slots;
+        };
+
+      public:
+        explicit WorkStealingDeque(std::int64_t capacity = 256)
+            : buffer{new Buffer(capacity)} {
+            retired.emplace_back(buffer.load(std::memory_order_relaxed));
+        }
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+        // Owner only.
+        void push(T* item) {
+            std::int64_t b = bottom.load(std::memory_order_relaxed);
+            std::int64_t t = top.load(std::memory_order_acquire);
+            Buffer* a = buffer.load(std::memory_order_relaxed);
+
+            if (b - t > a->size() - 1) {
+                a = a->grow(b, t);
+                // Thieves may still be reading the old buffer, so it is only
+                // reclaimed together with the deque.
+                retired.emplace_back(a);
+                buffer.store(a, std::memory_order_release);
+            }
+
+            a->put(b, item);
+            // seq_cst rather than release: callers rely on this store being
+            // ordered before their check for sleeping workers.
+            bottom.store(b + 1, std::memory_order_seq_cst);
+        }
+
+        // Owner only. Returns nullptr when the deque is empty.
+        T* pop() {
+            std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            Buffer* a = buffer.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_seq_cst);
+            std::int64_t t = top.load(std::memory_order_seq_cst);
+
+            if (t > b) {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            T* item = a->get(b);
+            if (t == b) {
+                // Last element, race against thieves for it.
+                if (!top.compare_exchange_strong(t,
+                                                 t + 1,
+                                                 std::memory_order_seq_cst,
+                                                 std::memory_order_relaxed)) {
+                    item = nullptr;
+                }
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+
+            return item;
+        }
+
+        // Any thread. Returns nullptr when the deque is empty or the steal
+        // lost a race with another thief or the owner.
+        T* steal() {
+            std::int64_t t = top.load(std::memory_order_seq_cst);
+            std::int64_t b = bottom.load(std::memory_order_seq_cst);
+
+            if (t >= b) {
+                return nullptr;
+            }
+
+            Buffer* a = buffer.load(std::memory_order_acquire);
+            T* item = a->get(t);
+            if (!top.compare_exchange_strong(t,
+                                             t + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+                return nullptr;
+            }
+
+            return item;
+        }
+
+        bool empty() const {
+            std::int64_t t = top.load(std::memory_order_seq_cst);
+            std::int64_t b = bottom.load(std::memory_order_seq_cst);
+            return b <= t;
+        }
+
+        // May be stale by the time it returns.
+        std::size_t size() const {
+            std::int64_t t = top.load(std::memory_order_relaxed);
+            std::int64_t b = bottom.load(std::memory_order_relaxed);
+            return b > t ? static_cast<std::size_t>(b - t) : 0;
+        }
+
+      private:
+        // Thieves write top and the owner writes bottom, so they sit on
+        // separate cache lines.
+        alignas(cache_line_size) std::atomic<std::int64_t> top{0};
+        alignas(cache_line_size) std::atomic<std::int64_t> bottom{0};
+        std::atomic<Buffer*> buffer;
+        std::vector<std::unique_ptr<Buffer>> retired;
+    };
+}  // namespace thread_pool_detail
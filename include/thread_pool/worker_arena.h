@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+
+namespace thread_pool_detail {
+    // Bump allocator owned by one worker and handed to its tasks through
+    // ThreadPool::this_worker_resource. deallocate does nothing; the worker
+    // calls reset after every task instead, which makes the whole arena
+    // available again. Blocks are kept across resets, and blocks added
+    // while running a task are merged into one the next time, so once the
+    // arena has grown to fit a task's allocations, tasks like it never
+    // reach the global allocator. Only ever used by its own thread.
+    class WorkerArena : public std::pmr::memory_resource {
+        static constexpr std::size_t initial_size = 64 * 1024;
+
+        struct Block {
+            Block* next;
+        };
+
+      public:
+        WorkerArena() = default;
+
+        WorkerArena(const WorkerArena&) = delete;
+        WorkerArena& operator=(const WorkerArena&) = delete;
+
+        ~WorkerArena() override {
+            release();
+        }
+
+        // Invalidates everything allocated since the last reset.
+        void reset() {
+            if (blocks == nullptr) {
+                return;
+            }
+
+            if (blocks->next != nullptr) {
+                const std::size_t total = capacity;
+                release();
+                add_block(total);
+            }
+            cursor = data(blocks);
+        }
+
+        // Frees every block.
+        void release() {
+            while (blocks != nullptr) {
+                Block* next = blocks->next;
+                ::operator delete(blocks);
+                blocks = next;
+            }
+            cursor = nullptr;
+            end = nullptr;
+            capacity = 0;
+        }
+
+      private:
+        static std::byte* data(Block* block) {
+            return reinterpret_cast<std::byte*>(block) + header_size;
+        }
+
+        static constexpr std::size_t header_size =
+            (sizeof(Block) + alignof(std::max_align_t) - 1) /
+            alignof(std::max_align_t) * alignof(std::max_align_t);
+
+        void add_block(std::size_t size) {
+            auto* block =
+                static_cast<Block*>(::operator new(header_size + size));
+            block->next = blocks;
+            blocks = block;
+            cursor = data(block);
+            end = cursor + size;
+            capacity += size;
+        }
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            void* pointer = cursor;
+            std::size_t space = static_cast<std::size_t>(end - cursor);
+            if (cursor == nullptr ||
+                !std::align(alignment, bytes, pointer, space)) {
+                // Doubles the arena, and always fits one such allocation.
+                add_block(
+                    std::max({initial_size, capacity, bytes + alignment}));
+                pointer = cursor;
+                space = static_cast<std::size_t>(end - cursor);
+                std::align(alignment, bytes, pointer, space);
+            }
+
+            cursor = static_cast<std::byte*>(pointer) + bytes;
+            return pointer;
+        }
+
+        void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+        bool do_is_equal(
+            const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        Block* blocks = nullptr;
+        std::byte* cursor = nullptr;
+        std::byte* end = nullptr;
+        // Sum of the block sizes.
+        std::size_t capacity = 0;
+    };
+
+    // The arena of the worker running on this thread, if any.
+    inline thread_local WorkerArena* current_arena = nullptr;
+}  // namespace thread_pool_detail
@@ -0,0 +1,499 @@
+// Benchmark harness: every workload runs on the pool, submitted from the
+// main thread or from several producer threads at once, on one std::async
+// thread per task and on the calling thread alone, with warmup runs,
+// repeated measurements of wall and CPU time, and summary statistics.
+// Recursive fibonacci and quicksort compare TaskGroup against futures and
+// serial code, and empty_round_trip measures contention on the queue lock.
+// --json writes the results in Google Benchmark's JSON layout, which
+// benchmark.py compares against a stored baseline.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <thread_pool.h>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+struct BenchmarkConfig {
+    std::size_t num_threads = std::thread::hardware_concurrency();
+    std::size_t num_tasks = 10000;
+    std::size_t warmup = 2;
+    std::size_t repetitions = 10;
+    std::size_t producers = 4;
+    std::string filter;
+    std::string json_path;
+    bool contention = false;
+};
+
+std::size_t fibonacci(std::size_t n) {
+    if (n <= 1) {
+        return n;
+    }
+    return fibonacci(n - 1) + fibonacci(n - 2);
+}
+
+// Splits fibonacci(n) into a child per left branch down to serial_below,
+// on a TaskGroup or on futures and wait()
+template <typename Pool>
+std::size_t group_fibonacci(Pool& pool,
+                            std::size_t n,
+                            std::size_t serial_below) {
+    if (n < serial_below) {
+        return fibonacci(n);
+    }
+    TaskGroup group(pool);
+    std::size_t left = 0;
+    group.run([&]() { left = group_fibonacci(pool, n - 1, serial_below); });
+    const std::size_t right = group_fibonacci(pool, n - 2, serial_below);
+    group.wait();
+    return left + right;
+}
+
+template <typename Pool>
+std::size_t future_fibonacci(Pool& pool,
+                             std::size_t n,
+                             std::size_t serial_below) {
+    if (n < serial_below) {
+        return fibonacci(n);
+    }
+    auto left = pool.submit_task([&pool, n, serial_below]() {
+        return future_fibonacci(pool, n - 1, serial_below);
+    });
+    const std::size_t right = future_fibonacci(pool, n - 2, serial_below);
+    return pool.wait(left) + right;
+}
+
+// Sorts the left partition as a child and the right one in place, down to
+// std::sort below serial_below elements
+template <typename Pool>
+void group_quicksort(Pool& pool,
+                     int* begin,
+                     int* end,
+                     std::ptrdiff_t serial_below) {
+    if (end - begin < serial_below) {
+        std::sort(begin, end);
+        return;
+    }
+    const int pivot = begin[(end - begin) / 2];
+    int* less_end =
+        std::partition(begin, end, [pivot](int x) { return x < pivot; });
+    int* equal_end = std::partition(
+        less_end, end, [pivot](int x) { return x == pivot; });
+
+    TaskGroup group(pool);
+    group.run([&]() { group_quicksort(pool, begin, less_end, serial_below); });
+    group_quicksort(pool, equal_end, end, serial_below);
+    group.wait();
+}
+
+std::size_t memory_work(std::size_t size) {
+    std::vector<int> data(size);
+    std::iota(data.begin(), data.end(), 0);
+    return std::accumulate(data.begin(), data.end(), 0ULL);
+}
+
+// CPU time of the whole process, so it includes every worker thread
+double cpu_time_ms() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto to_ms = [](const timeval& time) {
+        return time.tv_sec * 1000.0 + time.tv_usec / 1000.0;
+    };
+    return to_ms(usage.ru_utime) + to_ms(usage.ru_stime);
+#else
+    return 1000.0 * std::clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+struct Summary {
+    double mean = 0;
+    double median = 0;
+    double p99 = 0;
+    double stddev = 0;
+};
+
+Summary summarize(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    const std::size_t count = samples.size();
+
+    Summary summary;
+    summary.mean =
+        std::accumulate(samples.begin(), samples.end(), 0.0) / count;
+    summary.median = count % 2 == 1 ? samples[count / 2]
+                                    : (samples[count / 2 - 1] +
+                                       samples[count / 2]) /
+                                          2.0;
+    // Nearest rank, which is the maximum for fewer than 100 samples
+    const std::size_t rank = static_cast<std::size_t>(
+        std::ceil(0.99 * static_cast<double>(count)));
+    summary.p99 = samples[std::max<std::size_t>(rank, 1) - 1];
+    double squares = 0;
+    for (double sample : samples) {
+        squares += (sample - summary.mean) * (sample - summary.mean);
+    }
+    summary.stddev = count > 1 ? std::sqrt(squares / (count - 1)) : 0.0;
+    return summary;
+}
+
+struct Result {
+    std::string name;
+    std::size_t repetitions;
+    Summary wall;
+    Summary cpu;
+};
+
+// A workload is some number of independent calls to one function
+struct Workload {
+    std::string name;
+    std::size_t tasks;
+    std::function<void()> task;
+};
+
+// Runs run warmup times untimed, then repetitions times measured
+Result measure(const std::string& name,
+               const BenchmarkConfig& config,
+               const std::function<void()>& run) {
+    for (std::size_t i = 0; i < config.warmup; ++i) {
+        run();
+    }
+
+    std::vector<double> wall_times;
+    std::vector<double> cpu_times;
+    for (std::size_t i = 0; i < config.repetitions; ++i) {
+        const double cpu_start = cpu_time_ms();
+        const auto wall_start = std::chrono::steady_clock::now();
+        run();
+        const auto wall_end = std::chrono::steady_clock::now();
+        const double cpu_end = cpu_time_ms();
+
+        wall_times.push_back(
+            std::chrono::duration<double, std::milli>(wall_end - wall_start)
+                .count());
+        cpu_times.push_back(cpu_end - cpu_start);
+    }
+
+    return {name, config.repetitions, summarize(wall_times),
+            summarize(cpu_times)};
+}
+
+template <typename Pool>
+void run_on_pool(Pool& pool, const Workload& workload) {
+    for (std::size_t i = 0; i < workload.tasks; ++i) {
+        pool.detach_task(workload.task);
+    }
+    pool.wait_idle();
+}
+
+// The same tasks split across producers threads submitting at once
+template <typename Pool>
+void run_from_producers(Pool& pool,
+                        const Workload& workload,
+                        std::size_t producers) {
+    std::vector<std::thread> threads;
+    for (std::size_t p = 0; p < producers; ++p) {
+        const std::size_t begin = workload.tasks * p / producers;
+        const std::size_t end = workload.tasks * (p + 1) / producers;
+        threads.emplace_back([&pool, &workload, begin, end]() {
+            for (std::size_t i = begin; i < end; ++i) {
+                pool.detach_task(workload.task);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    pool.wait_idle();
+}
+
+// One thread per task, with at most max_in_flight alive at once so large
+// workloads do not run out of threads
+void run_on_async(const Workload& workload) {
+    constexpr std::size_t max_in_flight = 256;
+    std::vector<std::future<void>> futures;
+    futures.reserve(max_in_flight);
+    for (std::size_t i = 0; i < workload.tasks; ++i) {
+        if (futures.size() == max_in_flight) {
+            for (auto& future : futures) {
+                future.get();
+            }
+            futures.clear();
+        }
+        futures.push_back(std::async(std::launch::async, workload.task));
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+}
+
+void run_on_caller(const Workload& workload) {
+    for (std::size_t i = 0; i < workload.tasks; ++i) {
+        workload.task();
+    }
+}
+
+std::vector<Workload> make_workloads(const BenchmarkConfig& config) {
+    const std::size_t tasks = config.num_tasks;
+    return {
+        {"empty", tasks, []() {}},
+        {"fibonacci", std::max<std::size_t>(tasks / 100, 1),
+         []() {
+             volatile std::size_t result = fibonacci(25);
+             (void)result;
+         }},
+        {"memory", tasks,
+         []() {
+             volatile std::size_t result = memory_work(1000);
+             (void)result;
+         }},
+        {"sleep", std::max<std::size_t>(tasks / 100, 1),
+         []() { std::this_thread::sleep_for(std::chrono::microseconds(200)); }},
+    };
+}
+
+void print_result(const Result& result) {
+    std::cout << std::left << std::setw(36) << result.name << std::right
+              << std::fixed << std::setprecision(3) << std::setw(11)
+              << result.wall.median << std::setw(11) << result.wall.p99
+              << std::setw(11) << result.wall.stddev << std::setw(11)
+              << result.cpu.median << std::endl;
+}
+
+void write_json(const std::string& path,
+                const BenchmarkConfig& config,
+                const std::vector<Result>& results) {
+    std::ofstream out(path);
+    out << "{\n  \"context\": {\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency()
+        << ",\n    \"threads\": " << config.num_threads
+        << ",\n    \"tasks\": " << config.num_tasks
+        << ",\n    \"warmup\": " << config.warmup
+        << ",\n    \"repetitions\": " << config.repetitions
+        << ",\n    \"producers\": " << config.producers
+        << "\n  },\n  \"benchmarks\": [";
+
+    bool first = true;
+    for (const Result& result : results) {
+        const std::pair<const char*, double Summary::*> aggregates[] = {
+            {"mean", &Summary::mean},
+            {"median", &Summary::median},
+            {"p99", &Summary::p99},
+            {"stddev", &Summary::stddev},
+        };
+        for (const auto& [aggregate, field] : aggregates) {
+            out << (first ? "\n" : ",\n") << "    {\"name\": \""
+                << result.name << "_" << aggregate << "\", \"run_name\": \""
+                << result.name
+                << "\", \"run_type\": \"aggregate\", \"aggregate_name\": \""
+                << aggregate << "\", \"repetitions\": " << result.repetitions
+                << ", \"real_time\": " << std::setprecision(6)
+                << result.wall.*field
+                << ", \"cpu_time\": " << result.cpu.*field
+                << ", \"time_unit\": \"ms\"}";
+            first = false;
+        }
+    }
+    out << "\n  ]\n}\n";
+}
+
+// threads submitters each run tasks / threads empty tasks, one at a time.
+template <typename Pool>
+void round_trip(Pool& pool, std::size_t threads, std::size_t tasks) {
+    std::vector<std::thread> submitters;
+    for (std::size_t t = 0; t < threads; ++t) {
+        submitters.emplace_back([&]() {
+            for (std::size_t i = 0; i < tasks / threads; ++i) {
+                pool.submit_task([]() {}).get();
+            }
+        });
+    }
+    for (std::thread& submitter : submitters) {
+        submitter.join();
+    }
+}
+
+// Time every worker spent running tasks against waiting for queue_mutex.
+void print_contention(const ThreadPoolStats& stats) {
+    auto to_ms = [](std::chrono::nanoseconds time) {
+        return std::chrono::duration<double, std::milli>(time).count();
+    };
+    for (std::size_t index = 0; index < stats.workers.size(); ++index) {
+        const WorkerStats& worker = stats.workers[index];
+        std::cout << "  worker " << index << ": busy " << std::fixed
+                  << std::setprecision(3) << to_ms(worker.busy_time)
+                  << " ms, " << worker.lock_waits << " lock waits, "
+                  << to_ms(worker.lock_wait_time) << " ms waited"
+                  << std::endl;
+    }
+    std::cout << "  submitters: " << stats.caller_lock_waits
+              << " lock waits, " << to_ms(stats.caller_lock_wait_time)
+              << " ms waited" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    BenchmarkConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--tasks" && i + 1 < argc) {
+            config.num_tasks = std::stoull(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            config.num_threads = std::stoull(argv[++i]);
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            config.warmup = std::stoull(argv[++i]);
+        } else if (arg == "--repetitions" && i + 1 < argc) {
+            config.repetitions = std::max<std::size_t>(
+                std::stoull(argv[++i]), 1);
+        } else if (arg == "--producers" && i + 1 < argc) {
+            config.producers = std::max<std::size_t>(
+                std::stoull(argv[++i]), 1);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            config.filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            config.json_path = argv[++i];
+        } else if (arg == "--contention") {
+            config.contention = true;
+        } else if (arg == "--help" || arg == "-h") {
+            std::cout
+                << "Usage: " << argv[0] << " [options]\n"
+                << "Options:\n"
+                << "  --tasks N        Tasks per workload (default: "
+                << config.num_tasks << ")\n"
+                << "  --threads N      Pool threads (default: "
+                << config.num_threads << ")\n"
+                << "  --warmup N       Untimed runs first (default: "
+                << config.warmup << ")\n"
+                << "  --repetitions N  Timed runs (default: "
+                << config.repetitions << ")\n"
+                << "  --producers N    Submitting threads in the "
+                   "multi_producer runs (default: "
+                << config.producers << ")\n"
+                << "  --filter TEXT    Only benchmarks whose name contains "
+                   "TEXT\n"
+                << "  --json FILE      Write results as JSON\n"
+                << "  --contention     After each empty_round_trip run, "
+                   "print how long\n"
+                << "                   workers ran tasks and waited for the "
+                   "queue lock\n"
+                << "  --help, -h       Show this help\n";
+            return 0;
+        }
+    }
+
+    std::cout << "Threads: " << config.num_threads
+              << ", Tasks: " << config.num_tasks
+              << ", Warmup: " << config.warmup
+              << ", Repetitions: " << config.repetitions
+              << ", Producers: " << config.producers << std::endl;
+    std::cout << std::left << std::setw(36) << "Benchmark (ms)" << std::right
+              << std::setw(11) << "Median" << std::setw(11) << "p99"
+              << std::setw(11) << "Stddev" << std::setw(11) << "CPU"
+              << std::endl;
+    std::cout << std::string(80, '-') << std::endl;
+
+    ThreadPool<> pool(config.num_threads);
+    ThreadPool<false, true> stealing_pool(config.num_threads);
+    ThreadPool<> sharded_pool(config.num_threads,
+                              {.submission_shards = config.producers});
+
+    std::vector<Result> results;
+    auto run = [&](const std::string& name, const std::function<void()>& f) {
+        if (name.find(config.filter) == std::string::npos) {
+            return;
+        }
+        results.push_back(measure(name, config, f));
+        print_result(results.back());
+    };
+
+    for (const Workload& workload : make_workloads(config)) {
+        run(workload.name + "/thread_pool",
+            [&]() { run_on_pool(pool, workload); });
+        run(workload.name + "/work_stealing",
+            [&]() { run_on_pool(stealing_pool, workload); });
+        run(workload.name + "/multi_producer",
+            [&]() { run_from_producers(pool, workload, config.producers); });
+        run(workload.name + "/multi_producer_sharded", [&]() {
+            run_from_producers(sharded_pool, workload, config.producers);
+        });
+        run(workload.name + "/std_async", [&]() { run_on_async(workload); });
+        run(workload.name + "/single_thread",
+            [&]() { run_on_caller(workload); });
+    }
+
+    // Recursive divide and conquer
+    constexpr std::size_t fib_number = 32;
+    constexpr std::size_t fib_serial_below = 20;
+    run("parallel_fibonacci/task_group", [&]() {
+        volatile std::size_t result =
+            group_fibonacci(stealing_pool, fib_number, fib_serial_below);
+        (void)result;
+    });
+    run("parallel_fibonacci/task_group_shared", [&]() {
+        volatile std::size_t result =
+            group_fibonacci(pool, fib_number, fib_serial_below);
+        (void)result;
+    });
+    run("parallel_fibonacci/futures", [&]() {
+        volatile std::size_t result =
+            future_fibonacci(stealing_pool, fib_number, fib_serial_below);
+        (void)result;
+    });
+    run("parallel_fibonacci/single_thread", [&]() {
+        volatile std::size_t result = fibonacci(fib_number);
+        (void)result;
+    });
+
+    std::vector<int> unsorted(config.num_tasks * 100);
+    std::mt19937 generator(42);
+    for (int& value : unsorted) {
+        value = static_cast<int>(generator());
+    }
+    run("parallel_quicksort/task_group", [&]() {
+        std::vector<int> data = unsorted;
+        group_quicksort(stealing_pool, data.data(), data.data() + data.size(),
+                        4096);
+    });
+    run("parallel_quicksort/std_sort", [&]() {
+        std::vector<int> data = unsorted;
+        std::sort(data.begin(), data.end());
+    });
+
+    // Contention on the queue lock: every thread submits an empty task and
+    // waits for it, so nearly all the time goes to the submit and wake-up
+    // paths. --contention repeats each run once on a pool with stats.
+    for (std::size_t threads = 1;; threads *= 2) {
+        threads = std::min(threads, config.num_threads);
+        const std::string name =
+            "empty_round_trip/threads:" + std::to_string(threads);
+        run(name, [&]() { round_trip(pool, threads, config.num_tasks); });
+        if (config.contention &&
+            name.find(config.filter) != std::string::npos) {
+            ThreadPool<true, false, true> profiled(config.num_threads);
+            round_trip(profiled, threads, config.num_tasks);
+            print_contention(profiled.get_stats());
+        }
+        if (threads >= config.num_threads) {
+            break;
+        }
+    }
+
+    if (!config.json_path.empty()) {
+        write_json(config.json_path, config, results);
+        std::cout << "Results written to " << config.json_path << std::endl;
+    }
+    return 0;
+}
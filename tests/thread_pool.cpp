@@ -1,23 +1,65 @@
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <latch>
+#include <limits>
+#include <memory_resource>
+#include <mutex>
+#include <new>
 #include <numeric>
+#include <queue>
 #include <random>
+#include <ranges>
+#include <stop_token>
 #include <string>
 #include <thread>
 #include <thread_pool.h>
+#include <type_traits>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
 // Performance test configuration
 struct TestConfig {
     std::size_t num_threads = std::thread::hardware_concurrency();
     std::size_t num_tasks = 10000;
     std::size_t num_iterations = 5;
     bool verbose = false;
+    // Where test_tracing writes its Chrome trace, empty for nowhere
+    std::string trace_path;
 };
 
+// Counts calls into the global allocator, so tests can report heap
+// allocations per submission
+std::atomic<std::size_t> heap_allocations{0};
+
+void* operator new(std::size_t size) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+// Kept out of line, otherwise GCC pairs the inlined free() with the
+// operator new call site and reports a mismatch
+[[gnu::noinline]] void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
 // Simple CPU-intensive task
 std::size_t fibonacci(std::size_t n) {
     if (n <= 1) {
@@ -38,6 +80,31 @@ std::size_t memory_work(std::size_t size) {
     return std::accumulate(data.begin(), data.end(), 0ULL);
 }
 
+// The same on memory from resource
+std::size_t memory_work(std::size_t size,
+                        std::pmr::memory_resource* resource) {
+    std::pmr::vector<int> data(size, resource);
+    std::iota(data.begin(), data.end(), 0);
+    return std::accumulate(data.begin(), data.end(), 0ULL);
+}
+
+// Voluntary and involuntary context switches of the whole process so far.
+// A worker parking on a futex shows up as a voluntary switch.
+struct ContextSwitches {
+    long voluntary = 0;
+    long involuntary = 0;
+};
+
+ContextSwitches context_switches() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return {usage.ru_nvcsw, usage.ru_nivcsw};
+#else
+    return {};
+#endif
+}
+
 // Benchmark helper
 template <typename Func>
 double measure_execution_time(Func&& func,
@@ -65,6 +132,7 @@ void test_submission_overhead(const TestConfig& config) {
               << ", Threads: " << config.num_threads << std::endl;
 
     std::vector<double> times;
+    std::size_t allocations = 0;
 
     for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
         ThreadPool pool(config.num_threads);
@@ -74,10 +142,14 @@ void test_submission_overhead(const TestConfig& config) {
         // Measure ONLY the submission time
         auto time = measure_execution_time(
             [&]() {
+                const std::size_t allocations_before = heap_allocations.load();
+
                 for (std::size_t i = 0; i < config.num_tasks; ++i) {
                     futures.emplace_back(pool.submit_task(
                         [i]() { return static_cast<int>(i); }));
                 }
+
+                allocations += heap_allocations.load() - allocations_before;
             },
             "Submission overhead iteration " + std::to_string(iter),
             config.verbose);
@@ -101,6 +173,78 @@ void test_submission_overhead(const TestConfig& config) {
     std::cout << "Microseconds per submission: " << std::fixed
               << std::setprecision(2) << microseconds_per_task << " μs"
               << std::endl;
+    std::cout << "Heap allocations per submission: " << std::fixed
+              << std::setprecision(3)
+              << static_cast<double>(allocations) /
+                     (config.num_tasks * config.num_iterations)
+              << std::endl;
+}
+
+// Test 1.25: Detached vs future-returning submission
+void test_detached_submission_overhead(const TestConfig& config) {
+    std::cout << "\n=== Detached Submission Overhead Test ===" << std::endl;
+    std::cout << "Tasks: " << config.num_tasks
+              << ", Threads: " << config.num_threads << std::endl;
+
+    std::vector<double> future_times;
+    std::vector<double> detached_times;
+
+    for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+        ThreadPool pool(config.num_threads);
+
+        std::vector<std::future<void>> futures;
+        futures.reserve(config.num_tasks);
+        std::atomic<std::size_t> sum{0};
+
+        future_times.push_back(measure_execution_time(
+            [&]() {
+                for (std::size_t i = 0; i < config.num_tasks; ++i) {
+                    futures.emplace_back(pool.submit_task([&sum, i]() {
+                        sum.fetch_add(i, std::memory_order_relaxed);
+                    }));
+                }
+            },
+            "Future submission iteration " + std::to_string(iter),
+            config.verbose));
+
+        for (auto& future : futures) {
+            future.get();
+        }
+
+        std::latch done(static_cast<std::ptrdiff_t>(config.num_tasks));
+
+        detached_times.push_back(measure_execution_time(
+            [&]() {
+                for (std::size_t i = 0; i < config.num_tasks; ++i) {
+                    pool.detach_task([&sum, &done, i]() {
+                        sum.fetch_add(i, std::memory_order_relaxed);
+                        done.count_down();
+                    });
+                }
+            },
+            "Detached submission iteration " + std::to_string(iter),
+            config.verbose));
+
+        done.wait();
+    }
+
+    double avg_future = std::accumulate(future_times.begin(),
+                                        future_times.end(),
+                                        0.0) /
+                        future_times.size();
+    double avg_detached = std::accumulate(detached_times.begin(),
+                                          detached_times.end(),
+                                          0.0) /
+                          detached_times.size();
+
+    std::cout << "Future submissions/second: " << std::fixed
+              << std::setprecision(0)
+              << (config.num_tasks * 1000.0) / avg_future << std::endl;
+    std::cout << "Detached submissions/second: " << std::fixed
+              << std::setprecision(0)
+              << (config.num_tasks * 1000.0) / avg_detached << std::endl;
+    std::cout << "Detached speedup: " << std::fixed << std::setprecision(2)
+              << avg_future / avg_detached << "x" << std::endl;
 }
 
 // Test 1.5: End-to-end task throughput
@@ -110,6 +254,7 @@ void test_end_to_end_throughput(const TestConfig& config) {
               << ", Threads: " << config.num_threads << std::endl;
 
     std::vector<double> times;
+    std::vector<double> bulk_times;
 
     for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
         ThreadPool pool(config.num_threads);
@@ -131,16 +276,393 @@ void test_end_to_end_throughput(const TestConfig& config) {
             config.verbose);
 
         times.push_back(time);
+
+        // Same tasks, enqueued under a single lock
+        auto bulk_time = measure_execution_time(
+            [&]() {
+                auto bulk_futures = pool.submit_bulk(
+                    std::views::iota(std::size_t{0}, config.num_tasks),
+                    [](std::size_t i) { return static_cast<int>(i); });
+
+                for (auto& future : bulk_futures) {
+                    future.get();
+                }
+            },
+            "Bulk end-to-end iteration " + std::to_string(iter),
+            config.verbose);
+
+        bulk_times.push_back(bulk_time);
     }
 
     double avg_time = std::accumulate(times.begin(), times.end(), 0.0) /
                       times.size();
     double tasks_per_second = (config.num_tasks * 1000.0) / avg_time;
+    double avg_bulk_time = std::accumulate(bulk_times.begin(),
+                                           bulk_times.end(),
+                                           0.0) /
+                           bulk_times.size();
 
     std::cout << "Average end-to-end time: " << std::fixed
               << std::setprecision(2) << avg_time << " ms" << std::endl;
     std::cout << "End-to-end tasks/second: " << std::fixed
               << std::setprecision(0) << tasks_per_second << std::endl;
+    std::cout << "Average bulk end-to-end time: " << std::fixed
+              << std::setprecision(2) << avg_bulk_time << " ms" << std::endl;
+    std::cout << "Bulk end-to-end tasks/second: " << std::fixed
+              << std::setprecision(0)
+              << (config.num_tasks * 1000.0) / avg_bulk_time << std::endl;
+}
+
+// Test 1.6: Cost of EnableStats, and what get_stats reports
+void test_stats(const TestConfig& config) {
+    std::cout << "\n=== Stats Overhead Test ===" << std::endl;
+    std::cout << "Tasks: " << config.num_tasks
+              << ", Threads: " << config.num_threads << std::endl;
+
+    auto run = [&](auto& pool) {
+        std::vector<double> times;
+        for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+            times.push_back(measure_execution_time(
+                [&]() {
+                    for (std::size_t i = 0; i < config.num_tasks; ++i) {
+                        pool.detach_task([]() { memory_work(100); });
+                    }
+                    pool.wait_idle();
+                },
+                "Stats iteration " + std::to_string(iter),
+                config.verbose));
+        }
+        return std::accumulate(times.begin(), times.end(), 0.0) /
+               times.size();
+    };
+
+    ThreadPool<true, false, false> plain_pool(config.num_threads);
+    ThreadPool<true, false, true> stats_pool(config.num_threads);
+    const double plain_time = run(plain_pool);
+    const double stats_time = run(stats_pool);
+
+    std::cout << "Without stats: " << std::fixed << std::setprecision(2)
+              << plain_time << " ms" << std::endl;
+    std::cout << "With stats: " << stats_time << " ms ("
+              << std::setprecision(1)
+              << (stats_time / plain_time - 1.0) * 100.0 << "% overhead)"
+              << std::endl;
+
+    const ThreadPoolStats stats = stats_pool.get_stats();
+    auto print_histogram = [](const std::string& name,
+                              const LatencyHistogram& histogram) {
+        std::cout << name << ": p50 " << histogram.percentile(50).count()
+                  << " ns, p99 " << histogram.percentile(99).count()
+                  << " ns, max " << histogram.max().count() << " ns"
+                  << std::endl;
+    };
+    print_histogram("Queue wait", stats.queue_wait);
+    print_histogram("Run time", stats.run_time);
+
+    std::cout << std::setw(8) << "Worker" << std::setw(12) << "Tasks"
+              << std::setw(10) << "Parks" << std::setw(14) << "Idle (ms)"
+              << std::setw(14) << "Busy (ms)" << std::setw(12) << "Lock waits"
+              << std::setw(14) << "Waited (ms)" << std::endl;
+    auto to_ms = [](std::chrono::nanoseconds time) {
+        return std::chrono::duration<double, std::milli>(time).count();
+    };
+    for (std::size_t index = 0; index < stats.workers.size(); ++index) {
+        const WorkerStats& worker = stats.workers[index];
+        std::cout << std::setw(8) << index << std::setw(12)
+                  << worker.tasks_executed << std::setw(10) << worker.parks
+                  << std::setw(14) << std::fixed << std::setprecision(2)
+                  << to_ms(worker.idle_time) << std::setw(14)
+                  << to_ms(worker.busy_time) << std::setw(12)
+                  << worker.lock_waits << std::setw(14)
+                  << to_ms(worker.lock_wait_time) << std::endl;
+    }
+    std::cout << "Submitters: " << stats.caller_lock_waits
+              << " lock waits, " << to_ms(stats.caller_lock_wait_time)
+              << " ms waited" << std::endl;
+}
+
+// Test 1.7: Cost of tracing every task with TraceRecorder
+void test_tracing(const TestConfig& config) {
+    std::cout << "\n=== Tracing Overhead Test ===" << std::endl;
+    std::cout << "Tasks: " << config.num_tasks
+              << ", Threads: " << config.num_threads << std::endl;
+
+    // Room for the submit, start and finish of every task plus parks
+    TraceRecorder recorder(config.num_tasks * 4);
+    ThreadPool<> pool(config.num_threads);
+
+    auto run = [&]() {
+        std::vector<double> times;
+        for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+            times.push_back(measure_execution_time(
+                [&]() {
+                    for (std::size_t i = 0; i < config.num_tasks; ++i) {
+                        pool.detach_task(TaskName{"memory_work"},
+                                         []() { memory_work(100); });
+                    }
+                    pool.wait_idle();
+                },
+                "Tracing iteration " + std::to_string(iter),
+                config.verbose));
+        }
+        return std::accumulate(times.begin(), times.end(), 0.0) /
+               times.size();
+    };
+
+    const double plain_time = run();
+    pool.set_trace_hooks(&recorder);
+    const double traced_time = run();
+    pool.set_trace_hooks(nullptr);
+
+    std::cout << "Without tracing: " << std::fixed << std::setprecision(2)
+              << plain_time << " ms" << std::endl;
+    std::cout << "With TraceRecorder: " << traced_time << " ms ("
+              << std::setprecision(1)
+              << (traced_time / plain_time - 1.0) * 100.0 << "% overhead)"
+              << std::endl;
+    std::cout << "Events recorded: " << recorder.size() << std::endl;
+
+    if (!config.trace_path.empty()) {
+        std::ofstream out(config.trace_path);
+        recorder.write_chrome_trace(out);
+        std::cout << "Trace written to " << config.trace_path << std::endl;
+    }
+}
+
+// Test 1.75: Bounded lock-free FIFO queue vs unbounded locked queue, and
+// the bounded queue chosen by options vs by policy
+void test_bounded_queue(const TestConfig& config) {
+    std::cout << "\n=== Bounded Queue Test ===" << std::endl;
+    std::cout << "Tasks: " << config.num_tasks
+              << ", Threads: " << config.num_threads << std::endl;
+
+    constexpr std::size_t capacity = 1024;
+
+    auto run = [&](const std::string& name,
+                   auto pool_type,
+                   ThreadPoolOptions options) {
+        using Pool = typename decltype(pool_type)::type;
+        std::vector<double> times;
+
+        for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+            Pool pool(config.num_threads, options);
+            std::atomic<std::size_t> sum{0};
+            std::latch done(static_cast<std::ptrdiff_t>(config.num_tasks));
+
+            times.push_back(measure_execution_time(
+                [&]() {
+                    for (std::size_t i = 0; i < config.num_tasks; ++i) {
+                        pool.detach_task([&sum, &done, i]() {
+                            sum.fetch_add(i, std::memory_order_relaxed);
+                            done.count_down();
+                        });
+                    }
+                    done.wait();
+                },
+                name + " iteration " + std::to_string(iter),
+                config.verbose));
+        }
+
+        double avg_time = std::accumulate(times.begin(), times.end(), 0.0) /
+                          times.size();
+        std::cout << name << " tasks/second: " << std::fixed
+                  << std::setprecision(0)
+                  << (config.num_tasks * 1000.0) / avg_time << std::endl;
+    };
+
+    using OptionsPool = std::type_identity<ThreadPool<false>>;
+    using PolicyPool = std::type_identity<
+        PolicyThreadPool<thread_pool_policy::BoundedFifoQueue<capacity>,
+                         thread_pool_policy::BlockingWait,
+                         thread_pool_policy::DiscardExceptions>>;
+
+    run("Unbounded", OptionsPool{}, {});
+    run("Bounded (" + std::to_string(capacity) + ", block)",
+        OptionsPool{},
+        {.queue_capacity = capacity,
+         .backpressure = BackpressurePolicy::Block});
+    run("Bounded (" + std::to_string(capacity) + ", spin)",
+        OptionsPool{},
+        {.queue_capacity = capacity,
+         .backpressure = BackpressurePolicy::Spin});
+    run("Bounded (" + std::to_string(capacity) + ", block, policy)",
+        PolicyPool{},
+        {.backpressure = BackpressurePolicy::Block});
+}
+
+// Test 1.77: Submitting from many threads, shared lock vs staging shards
+void test_multi_producer(const TestConfig& config) {
+    const std::size_t producers =
+        std::max<std::size_t>(4, std::thread::hardware_concurrency());
+    const std::size_t tasks_per_producer =
+        std::max<std::size_t>(config.num_tasks / producers, 1);
+    const std::size_t total_tasks = tasks_per_producer * producers;
+
+    std::cout << "\n=== Multi-Producer Submission Test ===" << std::endl;
+    std::cout << "Producers: " << producers << ", Tasks: " << total_tasks
+              << ", Threads: " << config.num_threads << std::endl;
+
+    auto run = [&](const std::string& name, ThreadPoolOptions options) {
+        std::vector<double> times;
+
+        for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+            ThreadPool<> pool(config.num_threads, options);
+            std::atomic<std::size_t> sum{0};
+
+            times.push_back(measure_execution_time(
+                [&]() {
+                    std::vector<std::thread> threads;
+                    for (std::size_t p = 0; p < producers; ++p) {
+                        threads.emplace_back([&]() {
+                            for (std::size_t i = 0; i < tasks_per_producer;
+                                 ++i) {
+                                pool.detach_task([&sum, i]() {
+                                    sum.fetch_add(i,
+                                                  std::memory_order_relaxed);
+                                });
+                            }
+                        });
+                    }
+                    for (auto& thread : threads) {
+                        thread.join();
+                    }
+                    pool.wait_idle();
+                },
+                name + " iteration " + std::to_string(iter),
+                config.verbose));
+
+            const std::size_t expected =
+                producers * (tasks_per_producer * (tasks_per_producer - 1) / 2);
+            if (sum.load() != expected) {
+                std::cerr << name << ": wrong sum " << sum.load()
+                          << std::endl;
+            }
+        }
+
+        double avg_time = std::accumulate(times.begin(), times.end(), 0.0) /
+                          times.size();
+        std::cout << name << " tasks/second: " << std::fixed
+                  << std::setprecision(0)
+                  << (total_tasks * 1000.0) / avg_time << std::endl;
+    };
+
+    run("Shared lock", {});
+    run("Staging shards (" + std::to_string(producers) + ")",
+        {.submission_shards = producers});
+}
+
+// Test 1.8: Submit-to-start latency of an idle pool per idle policy
+void test_wakeup_latency(const TestConfig& config) {
+    std::cout << "\n=== Wakeup Latency Test ===" << std::endl;
+
+    const std::size_t samples = std::min<std::size_t>(config.num_tasks, 1000);
+    std::cout << "Samples: " << samples
+              << ", Threads: " << config.num_threads << std::endl;
+
+    auto run = [&](const std::string& name,
+                   std::size_t num_threads,
+                   IdlePolicy idle_policy) {
+        ThreadPool<false> pool(num_threads, {.idle_policy = idle_policy});
+        std::vector<double> latencies;
+        latencies.reserve(samples);
+
+        for (std::size_t i = 0; i < samples; ++i) {
+            // Let the workers run out of work before every sample
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+
+            const auto submitted = std::chrono::steady_clock::now();
+            auto started = pool.submit_task(
+                []() { return std::chrono::steady_clock::now(); });
+
+            latencies.push_back(std::chrono::duration<double, std::micro>(
+                                    started.get() - submitted)
+                                    .count());
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) {
+            return latencies[static_cast<std::size_t>(
+                p * static_cast<double>(latencies.size() - 1))];
+        };
+
+        std::cout << name << " (" << num_threads << " threads) latency us:"
+                  << std::fixed << std::setprecision(2)
+                  << " p50 " << percentile(0.50) << ", p90 "
+                  << percentile(0.90) << ", p99 " << percentile(0.99)
+                  << ", max " << latencies.back() << std::endl;
+    };
+
+    run("Block", config.num_threads, IdlePolicy::Block);
+    run("Spin then park", config.num_threads, IdlePolicy::SpinThenPark);
+
+    // Spinning workers need a core each, leave one for the submitter
+    const std::size_t cores = std::max(std::thread::hardware_concurrency(), 2u);
+    run("Spin", std::min(config.num_threads, cores - 1), IdlePolicy::Spin);
+}
+
+// Test 1.9: Lateness of submit_at, the cost of many pending timers, and
+// submit_every
+void test_timers(const TestConfig& config) {
+    std::cout << "\n=== Timer Test ===" << std::endl;
+
+    using Clock = std::chrono::steady_clock;
+    ThreadPool<> pool(config.num_threads);
+
+    // One timer per millisecond, each reporting how late it ran
+    constexpr std::size_t num_timers = 100;
+    std::vector<std::future<double>> lateness;
+    const auto start = Clock::now();
+    for (std::size_t i = 0; i < num_timers; ++i) {
+        const auto due = start + std::chrono::milliseconds(i + 1);
+        lateness.push_back(pool.submit_at(due, [due]() {
+            return std::chrono::duration<double, std::micro>(Clock::now() -
+                                                             due)
+                .count();
+        }));
+    }
+    double total = 0;
+    double worst = 0;
+    for (auto& future : lateness) {
+        const double late = future.get();
+        total += late;
+        worst = std::max(worst, late);
+    }
+    std::cout << "submit_at lateness: mean " << std::fixed
+              << std::setprecision(1) << total / num_timers << " us, max "
+              << worst << " us" << std::endl;
+
+    // A large number of timers spread over one second
+    const std::size_t num_pending = std::max<std::size_t>(
+        config.num_tasks * 10, 1000);
+    std::atomic<std::size_t> fired{0};
+    std::vector<std::future<void>> pending;
+    pending.reserve(num_pending);
+    const double insert_time = measure_execution_time(
+        [&]() {
+            for (std::size_t i = 0; i < num_pending; ++i) {
+                pending.push_back(pool.submit_after(
+                    std::chrono::microseconds(i * 1000000 / num_pending),
+                    [&fired]() { ++fired; }));
+            }
+        },
+        "submit_after",
+        config.verbose);
+    for (auto& future : pending) {
+        future.get();
+    }
+    std::cout << num_pending << " timers: " << std::setprecision(0)
+              << insert_time * 1000000.0 / num_pending
+              << " ns per submit_after, " << fired.load() << " fired"
+              << std::endl;
+
+    // A 5 ms series for 100 ms
+    std::atomic<std::size_t> runs{0};
+    std::stop_source series = pool.submit_every(std::chrono::milliseconds(5),
+                                                [&runs]() { ++runs; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    series.request_stop();
+    std::cout << "submit_every(5 ms) ran " << runs.load()
+              << " times in 100 ms" << std::endl;
 }
 
 // Test 2: CPU-intensive workload
@@ -152,12 +674,14 @@ void test_cpu_intensive(const TestConfig& config) {
                                   20;  // Scale with thread count
 
     std::vector<double> times;
+    ContextSwitches switches;
 
     for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
         ThreadPool pool(config.num_threads);
         std::vector<std::future<std::size_t>> futures;
         futures.reserve(cpu_tasks);
 
+        const ContextSwitches before = context_switches();
         auto time = measure_execution_time(
             [&]() {
                 for (std::size_t i = 0; i < cpu_tasks; ++i) {
@@ -177,8 +701,11 @@ void test_cpu_intensive(const TestConfig& config) {
             },
             "CPU-intensive iteration " + std::to_string(iter),
             config.verbose);
+        const ContextSwitches after = context_switches();
 
         times.push_back(time);
+        switches.voluntary += after.voluntary - before.voluntary;
+        switches.involuntary += after.involuntary - before.involuntary;
     }
 
     double avg_time = std::accumulate(times.begin(), times.end(), 0.0) /
@@ -188,9 +715,410 @@ void test_cpu_intensive(const TestConfig& config) {
     std::cout << "Tasks: " << cpu_tasks << ", Throughput: " << std::fixed
               << std::setprecision(1) << (cpu_tasks * 1000.0) / avg_time
               << " tasks/sec" << std::endl;
+    std::cout << "Context switches per iteration: "
+              << switches.voluntary /
+                     static_cast<long>(config.num_iterations)
+              << " voluntary, "
+              << switches.involuntary /
+                     static_cast<long>(config.num_iterations)
+              << " involuntary" << std::endl;
+}
+
+// Test 2.1: Short-lived allocations from the global allocator vs the
+// worker's arena
+void test_worker_arena(const TestConfig& config) {
+    std::cout << "\n=== Worker Arena Test ===" << std::endl;
+    std::cout << "Tasks: " << config.num_tasks
+              << ", Threads: " << config.num_threads << std::endl;
+
+    // A few vectors of different sizes per task, as a parser or request
+    // handler would build
+    constexpr std::size_t sizes[] = {16, 100, 250, 1000};
+    ThreadPool<> pool(config.num_threads);
+    std::atomic<std::size_t> checksum = 0;
+
+    auto run = [&](auto&& allocate_and_work) {
+        std::vector<double> times;
+        for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+            times.push_back(measure_execution_time(
+                [&]() {
+                    for (std::size_t i = 0; i < config.num_tasks; ++i) {
+                        pool.detach_task([&]() {
+                            std::size_t sum = 0;
+                            for (std::size_t size : sizes) {
+                                sum += allocate_and_work(size);
+                            }
+                            checksum.fetch_add(sum,
+                                               std::memory_order_relaxed);
+                        });
+                    }
+                    pool.wait_idle();
+                },
+                "Arena iteration " + std::to_string(iter), config.verbose));
+        }
+        return std::accumulate(times.begin(), times.end(), 0.0) /
+               times.size();
+    };
+
+    const double global_time =
+        run([](std::size_t size) { return memory_work(size); });
+    const double arena_time = run([](std::size_t size) {
+        return memory_work(size, ThreadPool<>::this_worker_resource());
+    });
+
+    std::cout << "Global allocator: " << std::fixed << std::setprecision(2)
+              << global_time << " ms" << std::endl;
+    std::cout << "Worker arena: " << arena_time << " ms ("
+              << std::setprecision(1)
+              << (global_time / arena_time - 1.0) * 100.0 << "% faster)"
+              << std::endl;
+    if (config.verbose) {
+        std::cout << "Checksum: " << checksum.load() << std::endl;
+    }
+}
+
+// Test 2.2: Reduction into one shared atomic vs PerWorker accumulators
+void test_per_worker(const TestConfig& config) {
+    std::cout << "\n=== Per-Worker Reduction Test ===" << std::endl;
+    std::cout << "Tasks: " << config.num_tasks
+              << ", Threads: " << config.num_threads << std::endl;
+
+    // Every task adds this many values to the total
+    constexpr std::size_t values_per_task = 100;
+    ThreadPool<> pool(config.num_threads);
+
+    auto run = [&](auto&& add) {
+        std::vector<double> times;
+        for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+            times.push_back(measure_execution_time(
+                [&]() {
+                    for (std::size_t i = 0; i < config.num_tasks; ++i) {
+                        pool.detach_task([&add, i]() {
+                            for (std::size_t j = 0; j < values_per_task;
+                                 ++j) {
+                                add(i ^ j);
+                            }
+                        });
+                    }
+                    pool.wait_idle();
+                },
+                "Reduction iteration " + std::to_string(iter),
+                config.verbose));
+        }
+        return std::accumulate(times.begin(), times.end(), 0.0) /
+               times.size();
+    };
+
+    std::atomic<std::size_t> shared_total = 0;
+    const double atomic_time = run([&](std::size_t value) {
+        shared_total.fetch_add(value, std::memory_order_relaxed);
+    });
+
+    PerWorker<std::size_t> totals(pool);
+    const double per_worker_time =
+        run([&](std::size_t value) { totals.local() += value; });
+
+    std::cout << "Shared atomic: " << std::fixed << std::setprecision(2)
+              << atomic_time << " ms" << std::endl;
+    std::cout << "PerWorker: " << per_worker_time << " ms" << std::endl;
+    std::cout << "Totals match: "
+              << (shared_total.load() == totals.combine() ? "Yes" : "No")
+              << std::endl;
 }
 
-// Test 3: Mixed workload with different task types
+// Splits fibonacci(n) into a task per left branch down to serial_below.
+// Blocking in future.get() here would deadlock once every worker waits.
+template <typename Pool>
+std::size_t parallel_fibonacci(Pool& pool,
+                               std::size_t n,
+                               std::size_t serial_below) {
+    if (n < serial_below) {
+        return fibonacci(n);
+    }
+    auto left = pool.submit_task([&pool, n, serial_below]() {
+        return parallel_fibonacci(pool, n - 1, serial_below);
+    });
+    const std::size_t right = parallel_fibonacci(pool, n - 2, serial_below);
+    return pool.wait(left) + right;
+}
+
+// The same on a TaskGroup, without a future per split
+template <typename Pool>
+std::size_t group_fibonacci(Pool& pool,
+                            std::size_t n,
+                            std::size_t serial_below) {
+    if (n < serial_below) {
+        return fibonacci(n);
+    }
+    TaskGroup group(pool);
+    std::size_t left = 0;
+    group.run([&]() { left = group_fibonacci(pool, n - 1, serial_below); });
+    const std::size_t right = group_fibonacci(pool, n - 2, serial_below);
+    group.wait();
+    return left + right;
+}
+
+// Test 2.25: Recursive divide and conquer with help-while-waiting
+void test_recursive_parallelism(const TestConfig& config) {
+    std::cout << "\n=== Recursive Parallelism Test ===" << std::endl;
+
+    constexpr std::size_t fib_number = 32;
+    constexpr std::size_t serial_below = 20;
+    const std::size_t expected = fibonacci(fib_number);
+
+    auto run = [&](const std::string& name, auto&& compute) {
+        std::vector<double> times;
+        for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+            std::size_t result = 0;
+            times.push_back(measure_execution_time(
+                [&]() { result = compute(); },
+                name + " iteration " + std::to_string(iter),
+                config.verbose));
+            if (result != expected) {
+                std::cerr << name << ": wrong result " << result << std::endl;
+            }
+        }
+        std::cout << name << ": " << std::fixed << std::setprecision(2)
+                  << std::accumulate(times.begin(), times.end(), 0.0) /
+                         times.size()
+                  << " ms" << std::endl;
+    };
+
+    run("Serial", [&]() { return fibonacci(fib_number); });
+    {
+        ThreadPool pool(config.num_threads);
+        run("Shared queue + wait", [&]() {
+            return parallel_fibonacci(pool, fib_number, serial_below);
+        });
+    }
+    {
+        ThreadPool<false, true> pool(config.num_threads);
+        run("Work stealing + wait", [&]() {
+            return parallel_fibonacci(pool, fib_number, serial_below);
+        });
+        run("Work stealing + TaskGroup", [&]() {
+            return group_fibonacci(pool, fib_number, serial_below);
+        });
+    }
+}
+
+// Test 2.5: Priority lanes vs binary heap as the priority queue
+void test_priority_queue(const TestConfig& config) {
+    std::cout << "\n=== Priority Queue Test ===" << std::endl;
+
+    const std::size_t num_tasks = std::max<std::size_t>(config.num_tasks,
+                                                        10000);
+    std::cout << "Tasks: " << num_tasks << std::endl;
+
+    using Task = thread_pool_detail::TaskFunction;
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> priority_dist(-128, 127);
+    std::vector<std::int8_t> priorities(num_tasks);
+    for (auto& priority : priorities) {
+        priority = static_cast<std::int8_t>(priority_dist(gen));
+    }
+
+    // The heap orders equal priorities by sequence number, so both queues
+    // produce the same order
+    struct HeapItem {
+        Task task;
+        std::int8_t priority;
+        std::size_t sequence;
+
+        bool operator<(const HeapItem& other) const {
+            return priority != other.priority ? priority < other.priority
+                                              : sequence > other.sequence;
+        }
+    };
+
+    std::size_t sum = 0;
+    std::vector<double> heap_times;
+    std::vector<double> lane_times;
+
+    for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+        heap_times.push_back(measure_execution_time(
+            [&]() {
+                std::priority_queue<HeapItem> heap;
+                for (std::size_t i = 0; i < num_tasks; ++i) {
+                    heap.push({[&sum, i]() { sum += i; }, priorities[i], i});
+                }
+                while (!heap.empty()) {
+                    Task task =
+                        std::move(const_cast<HeapItem&>(heap.top()).task);
+                    heap.pop();
+                    task();
+                }
+            },
+            "Heap iteration " + std::to_string(iter),
+            config.verbose));
+
+        lane_times.push_back(measure_execution_time(
+            [&]() {
+                thread_pool_detail::PriorityLanes<Task> lanes;
+                for (std::size_t i = 0; i < num_tasks; ++i) {
+                    lanes.push(priorities[i], [&sum, i]() { sum += i; });
+                }
+                while (!lanes.empty()) {
+                    lanes.pop()();
+                }
+            },
+            "Lanes iteration " + std::to_string(iter),
+            config.verbose));
+    }
+
+    double avg_heap = std::accumulate(heap_times.begin(),
+                                      heap_times.end(),
+                                      0.0) /
+                      heap_times.size();
+    double avg_lanes = std::accumulate(lane_times.begin(),
+                                       lane_times.end(),
+                                       0.0) /
+                       lane_times.size();
+
+    std::cout << "Heap push+pop: " << std::fixed << std::setprecision(1)
+              << avg_heap * 1e6 / num_tasks << " ns/task" << std::endl;
+    std::cout << "Lanes push+pop: " << std::fixed << std::setprecision(1)
+              << avg_lanes * 1e6 / num_tasks << " ns/task" << std::endl;
+    std::cout << "Lanes speedup: " << std::fixed << std::setprecision(2)
+              << avg_heap / avg_lanes << "x" << std::endl;
+
+    if (config.verbose) {
+        std::cout << "Checksum: " << sum << std::endl;
+    }
+}
+
+// Test 2.6: Low-priority starvation and deadline misses on one worker
+void test_priority_aging(const TestConfig& config) {
+    std::cout << "\n=== Priority Aging and Deadline Test ===" << std::endl;
+
+    const std::size_t num_tasks = std::min<std::size_t>(config.num_tasks,
+                                                        2000);
+    const auto task_time = std::chrono::microseconds(20);
+    std::cout << "Tasks: " << num_tasks << " x " << task_time.count()
+              << " us" << std::endl;
+
+    auto busy = [task_time]() {
+        const auto until = std::chrono::steady_clock::now() + task_time;
+        while (std::chrono::steady_clock::now() < until) {
+        }
+    };
+
+    // Eight higher-priority tasks that resubmit themselves for stream_time
+    // while one low-priority task waits. Without aging it only runs once
+    // the stream stops.
+    const auto stream_time = std::chrono::milliseconds(50);
+    auto starved = [&](std::chrono::milliseconds aging) {
+        ThreadPool<> pool(1, {.priority_aging = aging});
+        std::atomic<int> pending = 8;
+        std::latch gate(1);
+        pool.detach_task([&gate]() { gate.wait(); });
+
+        const auto submitted = std::chrono::steady_clock::now();
+        const auto stream_end = submitted + stream_time;
+        std::function<void()> stream = [&]() {
+            busy();
+            if (std::chrono::steady_clock::now() < stream_end) {
+                pool.detach_priority_task(10, stream);
+            } else {
+                // Release, so the copies of stream made above happen
+                // before it is destroyed
+                pending.fetch_sub(1, std::memory_order_release);
+            }
+        };
+
+        auto low = pool.submit_priority_task(
+            0, []() { return std::chrono::steady_clock::now(); });
+        for (int i = 0; i < 8; ++i) {
+            pool.detach_priority_task(10, stream);
+        }
+        gate.count_down();
+
+        const double latency = std::chrono::duration<double, std::milli>(
+                                   low.get() - submitted)
+                                   .count();
+        while (pending.load(std::memory_order_acquire) > 0) {
+            std::this_thread::yield();
+        }
+        return latency;
+    };
+
+    std::cout << "Low-priority latency under a " << stream_time.count()
+              << " ms stream without aging: " << std::fixed
+              << std::setprecision(2) << starved({}) << " ms" << std::endl;
+    std::cout << "Low-priority latency under a " << stream_time.count()
+              << " ms stream with 1 ms aging: " << std::fixed
+              << std::setprecision(2)
+              << starved(std::chrono::milliseconds(1)) << " ms" << std::endl;
+
+    // Deadlines spread over twice the time the tasks take back to back,
+    // submitted in random order. Run FIFO about a quarter are late, EDF
+    // meets nearly all.
+    const auto work_start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < num_tasks; ++i) {
+        busy();
+    }
+    const auto span = std::chrono::duration_cast<std::chrono::microseconds>(
+        2 * (std::chrono::steady_clock::now() - work_start));
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<long long> offset_dist(0, span.count());
+    std::vector<std::chrono::microseconds> offsets(num_tasks);
+    for (auto& offset : offsets) {
+        offset = std::chrono::microseconds(offset_dist(gen));
+    }
+
+    std::size_t fifo_late = 0;
+    {
+        ThreadPool<> pool(1);
+        std::latch gate(1);
+        pool.detach_task([&gate]() { gate.wait(); });
+
+        std::vector<std::future<bool>> late;
+        const auto start = std::chrono::steady_clock::now();
+        for (auto offset : offsets) {
+            late.push_back(
+                pool.submit_task([busy, deadline = start + offset]() {
+                    const bool missed =
+                        std::chrono::steady_clock::now() > deadline;
+                    busy();
+                    return missed;
+                }));
+        }
+        gate.count_down();
+        for (auto& future : late) {
+            fifo_late += future.get() ? 1 : 0;
+        }
+    }
+
+    std::size_t edf_late = 0;
+    {
+        ThreadPool<> pool(1, {.late_tasks = LateTaskPolicy::Drop});
+        std::latch gate(1);
+        pool.detach_task([&gate]() { gate.wait(); });
+
+        std::vector<std::future<void>> futures;
+        const auto start = std::chrono::steady_clock::now();
+        for (auto offset : offsets) {
+            futures.push_back(pool.submit_deadline_task(start + offset, busy));
+        }
+        gate.count_down();
+        for (auto& future : futures) {
+            try {
+                future.get();
+            } catch (const DeadlineMissedError&) {
+            }
+        }
+        edf_late = pool.missed_deadlines();
+    }
+
+    std::cout << "Late tasks FIFO: " << fifo_late << "/" << num_tasks
+              << ", EDF (dropped): " << edf_late << "/" << num_tasks
+              << std::endl;
+}
+
+// Test 3: Mixed workload with different task types, with the I/O tasks
+// on the compute workers and then on the blocking lane
 void test_mixed_workload(const TestConfig& config) {
     std::cout << "\n=== Mixed Workload Test ===" << std::endl;
 
@@ -200,59 +1128,264 @@ void test_mixed_workload(const TestConfig& config) {
     std::uniform_int_distribution<> io_duration_dist(1, 10);  // 1-10 ms
     std::uniform_int_distribution<> memory_size_dist(1000, 10000);
 
-    std::vector<double> times;
+    auto run = [&](const std::string& name, bool blocking_lane) {
+        std::vector<double> times;
+        ThreadPoolStats stats;
 
-    for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
-        ThreadPool pool(config.num_threads);
-        std::vector<std::future<void>> futures;
-        futures.reserve(config.num_tasks);
+        for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+            ThreadPool<true, false, true> pool(config.num_threads);
+            std::vector<std::future<void>> futures;
+            futures.reserve(config.num_tasks);
 
-        auto time = measure_execution_time(
-            [&]() {
-                for (std::size_t i = 0; i < config.num_tasks; ++i) {
-                    int task_type = task_type_dist(gen);
-
-                    switch (task_type) {
-                        case 0:  // CPU task
-                            futures.emplace_back(pool.submit_task([]() {
-                                fibonacci(25);  // Lighter CPU work
-                            }));
-                            break;
-
-                        case 1:  // I/O simulation
-                            futures.emplace_back(pool.submit_task(
-                                [&gen, &io_duration_dist]() -> void {
-                                    auto duration = std::chrono::microseconds(
-                                        io_duration_dist(gen) * 1000);
-                                    simulate_io_work(duration);
-                                }));
-                            break;
+            // Sizes and durations are drawn here, gen is not thread-safe
+            auto io_task = [](std::chrono::microseconds duration) -> void {
+                simulate_io_work(duration);
+            };
+
+            auto time = measure_execution_time(
+                [&]() {
+                    for (std::size_t i = 0; i < config.num_tasks; ++i) {
+                        int task_type = task_type_dist(gen);
 
-                        case 2:  // Memory work
-                            futures.emplace_back(pool.submit_task(
-                                [&gen, &memory_size_dist]() -> void {
-                                    memory_work(memory_size_dist(gen));
+                        switch (task_type) {
+                            case 0:  // CPU task
+                                futures.emplace_back(pool.submit_task([]() {
+                                    fibonacci(25);  // Lighter CPU work
                                 }));
-                            break;
+                                break;
+
+                            case 1: {  // I/O simulation
+                                const auto duration = std::chrono::microseconds(
+                                    io_duration_dist(gen) * 1000);
+                                futures.emplace_back(
+                                    blocking_lane
+                                        ? pool.submit_blocking_task(io_task,
+                                                                    duration)
+                                        : pool.submit_task(io_task, duration));
+                                break;
+                            }
+
+                            case 2:  // Memory work
+                                futures.emplace_back(pool.submit_task(
+                                    [size = memory_size_dist(gen)]() -> void {
+                                        memory_work(size);
+                                    }));
+                                break;
+                        }
                     }
-                }
 
-                for (auto& future : futures) {
-                    future.get();
-                }
-            },
-            "Mixed workload iteration " + std::to_string(iter),
-            config.verbose);
+                    for (auto& future : futures) {
+                        future.get();
+                    }
+                },
+                "Mixed workload iteration " + std::to_string(iter),
+                config.verbose);
 
-        times.push_back(time);
+            times.push_back(time);
+            stats = pool.get_stats();
+        }
+
+        double avg_time = std::accumulate(times.begin(), times.end(), 0.0) /
+                          times.size();
+        std::cout << name << " average time: " << std::fixed
+                  << std::setprecision(2) << avg_time << " ms" << std::endl;
+        std::cout << name << " mixed tasks/second: " << std::fixed
+                  << std::setprecision(0)
+                  << (config.num_tasks * 1000.0) / avg_time << std::endl;
+        std::cout << name << " utilization: compute " << std::setprecision(1)
+                  << stats.compute.utilization() * 100.0 << "%";
+        if (blocking_lane) {
+            std::cout << ", blocking " << stats.blocking.utilization() * 100.0
+                      << "%";
+        }
+        std::cout << std::endl;
+    };
+
+    run("Shared workers", false);
+    run("Blocking lane", true);
+}
+
+// Completes promises after a delay on its own thread, standing in for an
+// asynchronous I/O backend
+class SimulatedIo {
+  public:
+    SimulatedIo() : thread{[this]() { run(); }} {}
+
+    ~SimulatedIo() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_one();
+        thread.join();
     }
 
-    double avg_time = std::accumulate(times.begin(), times.end(), 0.0) /
-                      times.size();
-    std::cout << "Average time: " << std::fixed << std::setprecision(2)
-              << avg_time << " ms" << std::endl;
-    std::cout << "Mixed tasks/second: " << std::fixed << std::setprecision(0)
-              << (config.num_tasks * 1000.0) / avg_time << std::endl;
+    Future<void> wait_for(std::chrono::microseconds duration) {
+        Promise<void> promise;
+        Future<void> future = promise.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back({std::chrono::steady_clock::now() + duration,
+                               std::move(promise)});
+        }
+        cv.notify_one();
+        return future;
+    }
+
+  private:
+    struct Request {
+        std::chrono::steady_clock::time_point due;
+        Promise<void> promise;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            if (pending.empty()) {
+                cv.wait(lock);
+                continue;
+            }
+
+            auto next = std::min_element(
+                pending.begin(),
+                pending.end(),
+                [](const Request& a, const Request& b) {
+                    return a.due < b.due;
+                });
+            if (std::chrono::steady_clock::now() < next->due) {
+                cv.wait_until(lock, next->due);
+                continue;
+            }
+
+            // Completing the promise resumes the waiting coroutine here
+            Promise<void> promise = std::move(next->promise);
+            pending.erase(next);
+            lock.unlock();
+            promise.set_value();
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<Request> pending;
+    bool stopping = false;
+    std::thread thread;
+};
+
+// Waits for I/O without holding a worker, then hops back onto the pool for
+// the processing step
+Task<> io_handler(ThreadPool<>& pool,
+                  SimulatedIo& io,
+                  std::size_t waits,
+                  std::chrono::microseconds duration) {
+    for (std::size_t i = 0; i < waits; ++i) {
+        co_await io.wait_for(duration);
+        co_await pool.schedule();
+        memory_work(1000);
+    }
+}
+
+// Test 3.25: Blocking vs suspending I/O handlers
+void test_coroutine_io(const TestConfig& config) {
+    std::cout << "\n=== Coroutine I/O Handler Test ===" << std::endl;
+
+    const std::size_t handlers = std::min<std::size_t>(config.num_tasks / 10,
+                                                       200);
+    const std::size_t waits = 3;
+    const auto duration = std::chrono::milliseconds(1);
+    std::cout << "Handlers: " << handlers << ", I/O waits: " << waits
+              << " x " << duration.count() << " ms" << std::endl;
+
+    ThreadPool<> pool(config.num_threads);
+
+    const double blocking = measure_execution_time(
+        [&]() {
+            std::vector<std::future<void>> futures;
+            for (std::size_t i = 0; i < handlers; ++i) {
+                futures.push_back(pool.submit_task([&]() {
+                    for (std::size_t wait = 0; wait < waits; ++wait) {
+                        simulate_io_work(duration);
+                        memory_work(1000);
+                    }
+                }));
+            }
+            for (auto& future : futures) {
+                future.get();
+            }
+        },
+        "Blocking handlers",
+        config.verbose);
+
+    SimulatedIo io;
+    const double suspending = measure_execution_time(
+        [&]() {
+            std::vector<Future<void>> futures;
+            for (std::size_t i = 0; i < handlers; ++i) {
+                futures.push_back(pool.submit_coroutine(
+                    io_handler(pool, io, waits, duration)));
+            }
+            for (auto& future : futures) {
+                future.get();
+            }
+        },
+        "Coroutine handlers",
+        config.verbose);
+
+    std::cout << "Blocking handlers: " << std::fixed << std::setprecision(2)
+              << blocking << " ms" << std::endl;
+    std::cout << "Coroutine handlers: " << std::fixed << std::setprecision(2)
+              << suspending << " ms" << std::endl;
+}
+
+// Test 3.5: Fixed vs elastic pool on blocking tasks
+void test_elastic_pool(const TestConfig& config) {
+    std::cout << "\n=== Elastic Pool Test ===" << std::endl;
+
+    const std::size_t io_tasks = std::min<std::size_t>(config.num_tasks, 200);
+    const std::size_t max_threads = config.num_threads * 4;
+    std::cout << "Blocking tasks: " << io_tasks
+              << ", Threads: " << config.num_threads << " (elastic up to "
+              << max_threads << ")" << std::endl;
+
+    auto run = [&](const std::string& name, ThreadPoolOptions options) {
+        std::vector<double> times;
+        std::size_t peak_threads = 0;
+
+        for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+            ThreadPool pool(config.num_threads, options);
+            std::vector<std::future<void>> futures;
+            futures.reserve(io_tasks);
+
+            times.push_back(measure_execution_time(
+                [&]() {
+                    for (std::size_t i = 0; i < io_tasks; ++i) {
+                        futures.emplace_back(pool.submit_task([]() {
+                            simulate_io_work(std::chrono::milliseconds(2));
+                        }));
+                    }
+
+                    for (auto& future : futures) {
+                        peak_threads =
+                            std::max(peak_threads, pool.thread_count());
+                        future.get();
+                    }
+                },
+                name + " iteration " + std::to_string(iter),
+                config.verbose));
+        }
+
+        double avg_time = std::accumulate(times.begin(), times.end(), 0.0) /
+                          times.size();
+        std::cout << name << ": " << std::fixed << std::setprecision(2)
+                  << avg_time << " ms, peak threads " << peak_threads
+                  << std::endl;
+    };
+
+    run("Fixed", {});
+    run("Elastic",
+        {.max_threads = max_threads,
+         .blocked_after = std::chrono::milliseconds(1)});
 }
 
 // Test 4: Exception handling performance
@@ -314,23 +1447,562 @@ void test_exception_handling(const TestConfig& config) {
               << std::endl;
 }
 
-// Test 5: Scalability test
-void test_scalability(const TestConfig&) {
-    std::cout << "\n=== Thread Scalability Test ===" << std::endl;
+// Test 4.25: Work saved by cancelling timed-out requests
+void test_cancellation(const TestConfig& config) {
+    std::cout << "\n=== Cancellation Test ===" << std::endl;
 
-    const std::size_t base_tasks = 5000;
-    std::vector<std::size_t> thread_counts = {1, 2, 4, 8, 16, 32};
+    const std::size_t num_tasks = config.num_tasks;
+    ThreadPool<> pool(config.num_threads);
 
-    // Filter thread counts to reasonable values
-    std::size_t max_threads = std::thread::hardware_concurrency() * 2;
-    thread_counts.erase(std::remove_if(thread_counts.begin(),
-                                       thread_counts.end(),
-                                       [max_threads](std::size_t n) {
-                                           return n > max_threads;
-                                       }),
-                        thread_counts.end());
+    auto run = [&](const std::string& name, auto&& cancel) {
+        std::vector<std::stop_source> requests(num_tasks);
+        std::vector<std::future<std::size_t>> futures;
+        futures.reserve(num_tasks);
+        std::size_t cancelled = 0;
 
-    std::cout << "Base tasks per test: " << base_tasks << std::endl;
+        const double time = measure_execution_time(
+            [&]() {
+                for (auto& request : requests) {
+                    futures.push_back(pool.submit_task(
+                        request.get_token(), []() { return fibonacci(20); }));
+                }
+                cancel(requests);
+                for (auto& future : futures) {
+                    try {
+                        future.get();
+                    } catch (const TaskCancelledError&) {
+                        ++cancelled;
+                    }
+                }
+            },
+            name,
+            config.verbose);
+
+        std::cout << name << ": " << std::fixed << std::setprecision(2) << time
+                  << " ms, " << cancelled << "/" << num_tasks << " cancelled"
+                  << std::endl;
+    };
+
+    run("No cancellation", [](auto&) {});
+    // Every other request times out right after submission
+    run("Half the requests stopped", [](auto& requests) {
+        for (std::size_t i = 0; i < requests.size(); i += 2) {
+            requests[i].request_stop();
+        }
+    });
+    run("cancel_all", [&](auto&) { pool.cancel_all(); });
+}
+
+// Test 4.3: Waiting for a batch with wait_idle instead of one future per
+// task, and releasing a batch queued while paused
+void test_wait_idle(const TestConfig& config) {
+    std::cout << "\n=== Wait Idle / Pause Test ===" << std::endl;
+
+    const std::size_t num_tasks = config.num_tasks;
+    ThreadPool<> pool(config.num_threads);
+    std::atomic<std::size_t> completed{0};
+
+    auto run = [&](const std::string& name, auto&& body) {
+        completed = 0;
+        const double time = measure_execution_time(body, name, config.verbose);
+        if (completed != num_tasks) {
+            std::cerr << name << ": only " << completed << "/" << num_tasks
+                      << " tasks ran" << std::endl;
+        }
+        std::cout << name << ": " << std::fixed << std::setprecision(2) << time
+                  << " ms" << std::endl;
+    };
+
+    run("submit_task + future.get", [&]() {
+        std::vector<std::future<void>> futures;
+        futures.reserve(num_tasks);
+        for (std::size_t i = 0; i < num_tasks; ++i) {
+            futures.push_back(pool.submit_task([&]() { ++completed; }));
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+    });
+    run("detach_task + wait_idle", [&]() {
+        for (std::size_t i = 0; i < num_tasks; ++i) {
+            pool.detach_task([&]() { ++completed; });
+        }
+        pool.wait_idle();
+    });
+    // Workers stay parked while the batch is queued
+    run("pause + detach_task + resume", [&]() {
+        pool.pause();
+        for (std::size_t i = 0; i < num_tasks; ++i) {
+            pool.detach_task([&]() { ++completed; });
+        }
+        pool.resume();
+        pool.wait_idle();
+    });
+}
+
+// Test 4.5: parallel_for / parallel_reduce chunk policies
+void test_parallel_loops(const TestConfig& config) {
+    std::cout << "\n=== Parallel Loop Test ===" << std::endl;
+    std::cout << "Iterations per loop: " << config.num_tasks
+              << ", Threads: " << config.num_threads << std::endl;
+
+    constexpr std::size_t fib_number = 20;
+    constexpr std::size_t memory_size = 1000;
+    const std::size_t expected_memory_total =
+        config.num_tasks * (memory_size * (memory_size - 1) / 2);
+
+    std::cout << std::setw(10) << "Policy" << std::setw(16) << "Compute (ms)"
+              << std::setw(16) << "Memory (ms)" << std::endl;
+    std::cout << std::string(42, '-') << std::endl;
+
+    auto report = [&](const std::string& name,
+                      const std::vector<double>& compute_times,
+                      const std::vector<double>& memory_times) {
+        auto average = [](const std::vector<double>& times) {
+            return std::accumulate(times.begin(), times.end(), 0.0) /
+                   times.size();
+        };
+        std::cout << std::setw(10) << name << std::setw(16) << std::fixed
+                  << std::setprecision(2) << average(compute_times)
+                  << std::setw(16) << average(memory_times) << std::endl;
+    };
+
+    // Baseline: one submitted task per index
+    {
+        std::vector<double> compute_times;
+        std::vector<double> memory_times;
+
+        for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+            ThreadPool pool(config.num_threads);
+
+            compute_times.push_back(measure_execution_time(
+                [&]() {
+                    std::vector<std::future<std::size_t>> futures;
+                    futures.reserve(config.num_tasks);
+                    for (std::size_t i = 0; i < config.num_tasks; ++i) {
+                        futures.emplace_back(pool.submit_task(
+                            []() { return fibonacci(fib_number); }));
+                    }
+                    for (auto& future : futures) {
+                        future.get();
+                    }
+                },
+                "Per-task compute iteration " + std::to_string(iter),
+                config.verbose));
+
+            memory_times.push_back(measure_execution_time(
+                [&]() {
+                    std::vector<std::future<std::size_t>> futures;
+                    futures.reserve(config.num_tasks);
+                    for (std::size_t i = 0; i < config.num_tasks; ++i) {
+                        futures.emplace_back(pool.submit_task(
+                            []() { return memory_work(memory_size); }));
+                    }
+                    std::size_t total = 0;
+                    for (auto& future : futures) {
+                        total += future.get();
+                    }
+                    if (total != expected_memory_total) {
+                        throw std::runtime_error("Unexpected memory total");
+                    }
+                },
+                "Per-task memory iteration " + std::to_string(iter),
+                config.verbose));
+        }
+
+        report("per-task", compute_times, memory_times);
+    }
+
+    const std::pair<ChunkPolicy, std::string> policies[] = {
+        {ChunkPolicy::Static, "static"},
+        {ChunkPolicy::Guided, "guided"},
+        {ChunkPolicy::Auto, "auto"},
+    };
+
+    for (const auto& [policy, name] : policies) {
+        std::vector<double> compute_times;
+        std::vector<double> memory_times;
+
+        for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+            ThreadPool pool(config.num_threads);
+            std::vector<std::size_t> results(config.num_tasks);
+
+            compute_times.push_back(measure_execution_time(
+                [&]() {
+                    pool.parallel_for(
+                        std::size_t{0},
+                        config.num_tasks,
+                        [&](std::size_t i) {
+                            results[i] = fibonacci(fib_number);
+                        },
+                        policy);
+                },
+                name + " compute iteration " + std::to_string(iter),
+                config.verbose));
+
+            memory_times.push_back(measure_execution_time(
+                [&]() {
+                    std::size_t total = pool.parallel_reduce(
+                        std::size_t{0},
+                        config.num_tasks,
+                        std::size_t{0},
+                        [](std::size_t) { return memory_work(memory_size); },
+                        std::plus<>{},
+                        policy);
+                    if (total != expected_memory_total) {
+                        throw std::runtime_error("Unexpected memory total");
+                    }
+                },
+                name + " memory iteration " + std::to_string(iter),
+                config.verbose));
+        }
+
+        report(name, compute_times, memory_times);
+    }
+}
+
+// Test 4.75: Continuations, when_all and task graphs
+void test_continuations(const TestConfig& config) {
+    std::cout << "\n=== Continuations and Task Graph Test ===" << std::endl;
+
+    const std::size_t hops = config.num_tasks;
+    std::vector<double> chain_times;
+    std::vector<double> join_times;
+    std::vector<double> graph_times;
+    std::size_t graph_nodes = 0;
+
+    for (std::size_t iter = 0; iter < config.num_iterations; ++iter) {
+        ThreadPool<> pool(config.num_threads);
+
+        // Every hop is submitted by the task before it, nothing waits.
+        chain_times.push_back(measure_execution_time(
+            [&]() {
+                auto future = pool.submit_future([]() { return 0ULL; });
+                for (std::size_t i = 0; i < hops; ++i) {
+                    future = std::move(future).then(
+                        pool, [i](unsigned long long sum) { return sum + i; });
+                }
+                if (future.get() != hops * (hops - 1) / 2) {
+                    throw std::runtime_error("Wrong continuation result");
+                }
+            },
+            "Chain iteration " + std::to_string(iter),
+            config.verbose));
+
+        join_times.push_back(measure_execution_time(
+            [&]() {
+                std::vector<Future<std::size_t>> futures;
+                futures.reserve(hops);
+                for (std::size_t i = 0; i < hops; ++i) {
+                    futures.push_back(pool.submit_future([i]() { return i; }));
+                }
+                auto total = when_all(std::move(futures))
+                                 .then(pool, [](std::vector<std::size_t> all) {
+                                     return std::accumulate(
+                                         all.begin(), all.end(), 0ULL);
+                                 });
+                if (total.get() != hops * (hops - 1) / 2) {
+                    throw std::runtime_error("Wrong when_all result");
+                }
+            },
+            "when_all iteration " + std::to_string(iter),
+            config.verbose));
+
+        // Layers as wide as the pool, each node depending on its two
+        // neighbours in the layer above.
+        const std::size_t width = std::max<std::size_t>(config.num_threads,
+                                                        2);
+        const std::size_t depth = std::max<std::size_t>(hops / width, 1);
+        std::atomic<std::size_t> ran = 0;
+        TaskGraph graph;
+        for (std::size_t layer = 0; layer < depth; ++layer) {
+            for (std::size_t i = 0; i < width; ++i) {
+                const TaskGraph::Node node = graph.add([&ran]() {
+                    ran.fetch_add(1, std::memory_order_relaxed);
+                });
+                if (layer > 0) {
+                    const TaskGraph::Node above = (layer - 1) * width;
+                    graph.precede(above + i, node);
+                    graph.precede(above + (i + 1) % width, node);
+                }
+            }
+        }
+
+        graph_times.push_back(measure_execution_time(
+            [&]() {
+                graph.run(pool).get();
+                if (ran.load() != graph.size()) {
+                    throw std::runtime_error("Task graph skipped nodes");
+                }
+            },
+            "Graph iteration " + std::to_string(iter),
+            config.verbose));
+        graph_nodes = graph.size();
+    }
+
+    auto average = [](const std::vector<double>& times) {
+        return std::accumulate(times.begin(), times.end(), 0.0) /
+               times.size();
+    };
+
+    std::cout << "then() chain of " << hops << ": " << std::fixed
+              << std::setprecision(1) << average(chain_times) * 1e6 / hops
+              << " ns/hop" << std::endl;
+    std::cout << "when_all over " << hops << " futures: " << std::fixed
+              << std::setprecision(1) << average(join_times) * 1e6 / hops
+              << " ns/future" << std::endl;
+    std::cout << "Layered task graph of " << graph_nodes << ": " << std::fixed
+              << std::setprecision(1)
+              << average(graph_times) * 1e6 / graph_nodes << " ns/node"
+              << std::endl;
+}
+
+// Test 4.8: Per-connection handlers serialized by a mutex per connection
+// vs a strand per connection
+void test_strands(const TestConfig& config) {
+    std::cout << "\n=== Strand Test ===" << std::endl;
+
+    constexpr std::size_t num_connections = 64;
+    const std::size_t num_tasks = config.num_tasks;
+    ThreadPool<> pool(config.num_threads);
+
+    // Each handler appends to its connection's log, which a strand keeps in
+    // submission order without a lock.
+    struct Connection {
+        std::mutex mutex;
+        std::vector<std::size_t> log;
+    };
+
+    auto run = [&](const std::string& name, auto&& submit) {
+        std::vector<Connection> connections(num_connections);
+        const double time = measure_execution_time(
+            [&]() {
+                for (std::size_t i = 0; i < num_tasks; ++i) {
+                    submit(connections[i % num_connections], i);
+                }
+                pool.wait_idle();
+            },
+            name,
+            config.verbose);
+
+        bool ordered = true;
+        for (const Connection& connection : connections) {
+            ordered = ordered && std::ranges::is_sorted(connection.log);
+        }
+        std::cout << name << ": " << std::fixed << std::setprecision(2) << time
+                  << " ms, " << (ordered ? "in order" : "out of order")
+                  << std::endl;
+    };
+
+    run("mutex per connection", [&](Connection& connection, std::size_t i) {
+        pool.detach_task([&connection, i]() {
+            std::lock_guard<std::mutex> lock(connection.mutex);
+            connection.log.push_back(i);
+        });
+    });
+
+    // Not copies of one strand, which would share its queue
+    std::vector<Strand<ThreadPool<>>> strands;
+    for (std::size_t i = 0; i < num_connections; ++i) {
+        strands.emplace_back(pool);
+    }
+    run("strand per connection", [&](Connection& connection, std::size_t i) {
+        strands[i % num_connections].detach_task(
+            [&connection, i]() { connection.log.push_back(i); });
+    });
+}
+
+// Test 4.85: Strands and task groups on a full bounded queue that rejects
+// submissions
+void test_rejected_submissions(const TestConfig&) {
+    std::cout << "\n=== Rejected Submission Test ===" << std::endl;
+
+    ThreadPool<false> pool(1,
+                           {.queue_capacity = 16,
+                            .backpressure = BackpressurePolicy::Reject});
+
+    // Holds the only worker until release and fills the queue behind it
+    std::atomic<bool> held = false;
+    std::atomic<bool> release = false;
+    auto fill = [&]() {
+        held = false;
+        release = false;
+        pool.detach_task([&]() {
+            held = true;
+            while (!release) {
+                std::this_thread::yield();
+            }
+        });
+        while (!held) {
+            std::this_thread::yield();
+        }
+        try {
+            while (true) {
+                pool.detach_task([]() {});
+            }
+        } catch (const QueueFullError&) {
+        }
+    };
+
+    // The rejected task never runs, and the strand still takes new ones
+    Strand<ThreadPool<false>> strand(pool);
+    std::atomic<int> strand_runs = 0;
+    fill();
+    bool strand_rejected = false;
+    try {
+        strand.detach_task([&]() { ++strand_runs; });
+    } catch (const QueueFullError&) {
+        strand_rejected = true;
+    }
+    release = true;
+    pool.wait_idle();
+    strand.detach_task([&]() { ++strand_runs; });
+    pool.wait_idle();
+
+    std::cout << "Strand rejected: " << (strand_rejected ? "Yes" : "No")
+              << ", usable afterwards: " << (strand_runs == 1 ? "Yes" : "No")
+              << std::endl;
+    if (!strand_rejected || strand_runs != 1) {
+        throw std::runtime_error("Strand wedged by a rejected submission");
+    }
+
+    // Several producers race on one strand: every accepted task runs once,
+    // and no rejected one runs
+    constexpr std::size_t num_producers = 4;
+    constexpr std::size_t tasks_per_producer = 256;
+    std::vector<std::atomic<int>> task_runs(num_producers *
+                                            tasks_per_producer);
+    std::vector<std::vector<Future<void>>> accepted(num_producers);
+    std::vector<std::vector<std::size_t>> rejected(num_producers);
+    fill();
+    std::vector<std::thread> producers;
+    for (std::size_t p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&, p]() {
+            for (std::size_t i = 0; i < tasks_per_producer; ++i) {
+                const std::size_t id = p * tasks_per_producer + i;
+                try {
+                    accepted[p].push_back(
+                        strand.submit_future([&, id]() { ++task_runs[id]; }));
+                } catch (const QueueFullError&) {
+                    rejected[p].push_back(id);
+                }
+                // Let the worker go halfway, so some tasks get through
+                if (p == 0 && i == tasks_per_producer / 2) {
+                    release = true;
+                }
+            }
+        });
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+
+    std::size_t num_accepted = 0;
+    std::size_t num_rejected = 0;
+    bool all_completed = true;
+    for (std::size_t p = 0; p < num_producers; ++p) {
+        for (Future<void>& future : accepted[p]) {
+            all_completed = all_completed &&
+                            future.wait_for(std::chrono::seconds(10)) ==
+                                std::future_status::ready;
+        }
+        num_accepted += accepted[p].size();
+        num_rejected += rejected[p].size();
+    }
+    pool.wait_idle();
+
+    std::size_t runs_total = 0;
+    bool rejected_ran = false;
+    for (std::size_t p = 0; p < num_producers; ++p) {
+        for (std::size_t id : rejected[p]) {
+            rejected_ran = rejected_ran || task_runs[id] != 0;
+        }
+    }
+    for (const std::atomic<int>& runs : task_runs) {
+        runs_total += runs;
+    }
+
+    std::cout << num_producers << " producers: " << num_accepted
+              << " accepted, " << num_rejected << " rejected, "
+              << (all_completed && !rejected_ran &&
+                          runs_total == num_accepted
+                      ? "each accepted task ran once"
+                      : "tasks lost or run after rejection")
+              << std::endl;
+    if (!all_completed || rejected_ran || runs_total != num_accepted) {
+        throw std::runtime_error("Strand lost a task of another producer");
+    }
+
+    // No limit on queued children, so run posts even to a full pool
+    TaskGroup<ThreadPool<false>> group(pool,
+                                       std::numeric_limits<std::size_t>::max());
+    std::atomic<int> group_runs = 0;
+    fill();
+    bool group_rejected = false;
+    try {
+        group.run([&]() { ++group_runs; });
+    } catch (const QueueFullError&) {
+        group_rejected = true;
+    }
+    release = true;
+    group.wait();
+    pool.wait_idle();
+    group.run([&]() { ++group_runs; });
+    group.wait();
+
+    std::cout << "Task group rejected: " << (group_rejected ? "Yes" : "No")
+              << ", usable afterwards: " << (group_runs == 1 ? "Yes" : "No")
+              << std::endl;
+    if (!group_rejected || group_runs != 1) {
+        throw std::runtime_error("Task group broken by a rejected child");
+    }
+}
+
+// Test 4.9: Results and captures aligned beyond what operator new
+// guarantees
+void test_over_aligned(const TestConfig& config) {
+    std::cout << "\n=== Over-Aligned Task Test ===" << std::endl;
+
+    struct alignas(64) Wide {
+        int value;
+    };
+
+    ThreadPool pool(config.num_threads);
+
+    // Results live in the shared states of the promise and the Future
+    std::future<Wide> future = pool.submit_task([]() { return Wide{42}; });
+    Future<Wide> pool_future = pool.submit_future([]() { return Wide{43}; });
+    const bool results_ok =
+        future.get().value == 42 && pool_future.get().value == 43;
+
+    // The capture makes the callable over-aligned, so it is stored outside
+    // TaskFunction's inline storage
+    std::atomic<bool> capture_ok = false;
+    pool.detach_task([&capture_ok, wide = Wide{44}]() {
+        capture_ok = wide.value == 44 &&
+                     reinterpret_cast<std::uintptr_t>(&wide) % alignof(Wide) ==
+                         0;
+    });
+    pool.wait_idle();
+
+    std::cout << "Over-aligned results: " << (results_ok ? "Yes" : "No")
+              << ", over-aligned capture: " << (capture_ok ? "Yes" : "No")
+              << std::endl;
+    if (!results_ok || !capture_ok) {
+        throw std::runtime_error("Over-aligned task mishandled");
+    }
+}
+
+// Test 5: Scalability test. The tasks are submitted from the main thread,
+// or with fan_out from inside a root pool task, so that the work-stealing
+// scheduler sees them as local submissions.
+template <typename Pool>
+void test_scalability_with(const std::string& scheduler_name,
+                           const std::vector<std::size_t>& thread_counts,
+                           std::size_t base_tasks,
+                           bool fan_out,
+                           const ThreadPoolOptions& options = {}) {
+    std::cout << "\nScheduler: " << scheduler_name << std::endl;
     std::cout << std::setw(8) << "Threads" << std::setw(12) << "Time (ms)"
               << std::setw(15) << "Tasks/sec" << std::setw(12) << "Efficiency"
               << std::endl;
@@ -343,18 +2015,27 @@ void test_scalability(const TestConfig&) {
 
         for (std::size_t iter = 0; iter < 3;
              ++iter) {  // Fewer iterations for scalability test
-            ThreadPool pool(num_threads);
-            std::vector<std::future<int>> futures;
-            futures.reserve(base_tasks);
+            Pool pool(num_threads, options);
+
+            auto submit_all = [&pool, base_tasks]() {
+                std::vector<std::future<int>> futures;
+                futures.reserve(base_tasks);
+
+                for (std::size_t i = 0; i < base_tasks; ++i) {
+                    futures.emplace_back(pool.submit_task([i]() {
+                        fibonacci(30);  // Moderate CPU work
+                        return static_cast<int>(i);
+                    }));
+                }
+
+                return futures;
+            };
 
             auto time = measure_execution_time(
                 [&]() {
-                    for (std::size_t i = 0; i < base_tasks; ++i) {
-                        futures.emplace_back(pool.submit_task([i]() {
-                            fibonacci(30);  // Moderate CPU work
-                            return static_cast<int>(i);
-                        }));
-                    }
+                    std::vector<std::future<int>> futures =
+                        fan_out ? pool.submit_task(submit_all).get()
+                                : submit_all();
 
                     for (auto& future : futures) {
                         future.get();
@@ -384,6 +2065,60 @@ void test_scalability(const TestConfig&) {
     }
 }
 
+void test_scalability(const TestConfig&) {
+    std::cout << "\n=== Thread Scalability Test ===" << std::endl;
+
+    const std::size_t base_tasks = 5000;
+    std::vector<std::size_t> thread_counts = {1, 2, 4, 8, 16, 32};
+
+    // Filter thread counts to reasonable values
+    std::size_t max_threads = std::thread::hardware_concurrency() * 2;
+    thread_counts.erase(std::remove_if(thread_counts.begin(),
+                                       thread_counts.end(),
+                                       [max_threads](std::size_t n) {
+                                           return n > max_threads;
+                                       }),
+                        thread_counts.end());
+
+    std::cout << "Base tasks per test: " << base_tasks << std::endl;
+
+    test_scalability_with<ThreadPool<>>(
+        "global queue", thread_counts, base_tasks, false);
+    test_scalability_with<ThreadPool<>>(
+        "global queue, fanned out from a pool task",
+        thread_counts,
+        base_tasks,
+        true);
+    test_scalability_with<ThreadPool<false, true>>(
+        "work stealing, fanned out from a pool task",
+        thread_counts,
+        base_tasks,
+        true);
+
+    // Placement variants on a smaller workload, each against its own
+    // single-thread baseline
+    const std::size_t placement_tasks = base_tasks / 25;
+    std::cout << "\nPlacement variants, tasks per test: " << placement_tasks
+              << ", NUMA nodes: "
+              << thread_pool_detail::Topology::get().nodes().size()
+              << std::endl;
+
+    test_scalability_with<ThreadPool<>>(
+        "unpinned", thread_counts, placement_tasks, true);
+    test_scalability_with<ThreadPool<>>(
+        "pinned, packed per node",
+        thread_counts,
+        placement_tasks,
+        true,
+        {.affinity = AffinityPolicy::Compact});
+    test_scalability_with<ThreadPool<>>(
+        "pinned, spread across nodes, node-local queues",
+        thread_counts,
+        placement_tasks,
+        true,
+        {.affinity = AffinityPolicy::Scatter, .numa_local_queues = true});
+}
+
 int main(int argc, char* argv[]) {
     TestConfig config;
 
@@ -398,6 +2133,8 @@ int main(int argc, char* argv[]) {
             config.num_threads = std::stoull(argv[++i]);
         } else if (arg == "--iterations" && i + 1 < argc) {
             config.num_iterations = std::stoull(argv[++i]);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            config.trace_path = argv[++i];
         } else if (arg == "--help" || arg == "-h") {
             std::cout
                 << "Usage: " << argv[0] << " [options]\n"
@@ -408,6 +2145,7 @@ int main(int argc, char* argv[]) {
                 << config.num_threads << ")\n"
                 << "  --iterations N  Number of test iterations (default: "
                 << config.num_iterations << ")\n"
+                << "  --trace FILE    Write a Chrome trace of the tracing test\n"
                 << "  --verbose, -v   Enable verbose output\n"
                 << "  --help, -h      Show this help\n";
             return 0;
@@ -426,10 +2164,31 @@ int main(int argc, char* argv[]) {
 
     try {
         test_submission_overhead(config);
+        test_detached_submission_overhead(config);
         test_end_to_end_throughput(config);
+        test_stats(config);
+        test_tracing(config);
+        test_bounded_queue(config);
+        test_multi_producer(config);
+        test_wakeup_latency(config);
+        test_timers(config);
         test_cpu_intensive(config);
+        test_worker_arena(config);
+        test_per_worker(config);
+        test_recursive_parallelism(config);
+        test_priority_queue(config);
+        test_priority_aging(config);
         test_mixed_workload(config);
+        test_coroutine_io(config);
+        test_elastic_pool(config);
         test_exception_handling(config);
+        test_cancellation(config);
+        test_wait_idle(config);
+        test_parallel_loops(config);
+        test_continuations(config);
+        test_strands(config);
+        test_rejected_submissions(config);
+        test_over_aligned(config);
         test_scalability(config);
 
         std::cout << "\n=== Performance Tests Completed ===" << std::endl;